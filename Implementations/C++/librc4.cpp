@@ -0,0 +1,225 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <new>
+#include <cstring>
+#include "librc4.h"
+#include "rc4.h"
+#include "rc4_batch.h"
+
+#define LIBRC4_BATCH_CHUNK 64
+#define LIBRC4_PRNG_DROP 3072
+#define LIBRC4_PRNG_POOL 64
+
+struct librc4_ctx {
+	rc4_ctx state;
+};
+
+struct librc4_prng {
+	rc4_ctx state;
+	uint8_t pool[LIBRC4_PRNG_POOL];
+	uint32_t used;
+};
+
+static bool valid_key(const uint8_t* key, size_t key_size) {
+	return key != NULL && key_size > 0 && key_size <= LIBRC4_MAX_KEY_SIZE;
+}
+
+// Validated before rc4_init(), so the engine never prints from inside the library
+static void init_state(rc4_ctx* state, const uint8_t* key, size_t key_size) {
+	rc4_init(state, (uint8_t*) key, (uint16_t) key_size);
+}
+
+static void crypt_state(rc4_ctx* state, const uint8_t* in, uint8_t* out, size_t size) {
+	if (in == out)
+		encrypt_inplace(state, out, size);
+	else
+		rc4_crypt(state, in, out, size);
+}
+
+static void keystream_state(rc4_ctx* state, uint8_t* out, size_t size) {
+	memset(out, 0, size);
+	encrypt_inplace(state, out, size);
+}
+
+uint32_t librc4_version(void) {
+	return LIBRC4_VERSION;
+}
+
+int librc4_crypt(const uint8_t* key, size_t key_size, const uint8_t* in, uint8_t* out, size_t size) {
+	if (!valid_key(key, key_size) || (size > 0 && (in == NULL || out == NULL)))
+		return LIBRC4_EINVAL;
+	rc4_ctx state;
+	init_state(&state, key, key_size);
+	crypt_state(&state, in, out, size);
+	return LIBRC4_OK;
+}
+
+librc4_ctx* librc4_ctx_new(const uint8_t* key, size_t key_size) {
+	if (!valid_key(key, key_size))
+		return NULL;
+	librc4_ctx* ctx = new (std::nothrow) librc4_ctx;
+	if (ctx != NULL)
+		init_state(&ctx->state, key, key_size);
+	return ctx;
+}
+
+int librc4_ctx_reset(librc4_ctx* ctx, const uint8_t* key, size_t key_size) {
+	if (ctx == NULL || !valid_key(key, key_size))
+		return LIBRC4_EINVAL;
+	init_state(&ctx->state, key, key_size);
+	return LIBRC4_OK;
+}
+
+void librc4_ctx_free(librc4_ctx* ctx) {
+	if (ctx != NULL)
+		memset(ctx, 0, sizeof(*ctx));
+	delete ctx;
+}
+
+int librc4_ctx_crypt(librc4_ctx* ctx, const uint8_t* in, uint8_t* out, size_t size) {
+	if (ctx == NULL || (size > 0 && (in == NULL || out == NULL)))
+		return LIBRC4_EINVAL;
+	crypt_state(&ctx->state, in, out, size);
+	return LIBRC4_OK;
+}
+
+int librc4_ctx_keystream(librc4_ctx* ctx, uint8_t* out, size_t size) {
+	if (ctx == NULL || (size > 0 && out == NULL))
+		return LIBRC4_EINVAL;
+	keystream_state(&ctx->state, out, size);
+	return LIBRC4_OK;
+}
+
+int librc4_ctx_skip(librc4_ctx* ctx, uint64_t size) {
+	if (ctx == NULL)
+		return LIBRC4_EINVAL;
+	uint8_t scratch[4096];
+	while (size > 0) {
+		size_t step = (size < sizeof(scratch)) ? (size_t) size : sizeof(scratch);
+		keystream_state(&ctx->state, scratch, step);
+		size -= step;
+	}
+	return LIBRC4_OK;
+}
+
+// librc4_job is converted in chunks, so the C layout stays independent of rc4_job
+int librc4_batch(librc4_job* jobs, size_t job_count) {
+	if (jobs == NULL && job_count > 0)
+		return (int) job_count;
+
+	int failed = 0;
+	rc4_job chunk[LIBRC4_BATCH_CHUNK];
+	for (size_t first = 0; first < job_count; first += LIBRC4_BATCH_CHUNK) {
+		uint32_t count = (job_count - first < LIBRC4_BATCH_CHUNK) ? (uint32_t) (job_count - first) : LIBRC4_BATCH_CHUNK;
+		uint32_t used = 0;
+		uint32_t slot[LIBRC4_BATCH_CHUNK];
+		for (uint32_t n = 0; n < count; n++) {
+			librc4_job* job = &jobs[first + n];
+			if (!valid_key(job->key, job->key_size) || (job->size > 0 && job->out == NULL)) {
+				job->status = LIBRC4_EINVAL;
+				failed++;
+				continue;
+			}
+			chunk[used].key = (uint8_t*) job->key;
+			chunk[used].key_size = (uint16_t) job->key_size;
+			chunk[used].plaintext = (uint8_t*) job->in;
+			chunk[used].ciphertext = job->out;
+			chunk[used].size = job->size;
+			chunk[used].status = 0;
+			slot[used++] = n;
+		}
+		rc4_batch(chunk, used);
+		for (uint32_t n = 0; n < used; n++) {
+			jobs[first + slot[n]].status = (chunk[n].status == 0) ? LIBRC4_OK : LIBRC4_EINVAL;
+			failed += (chunk[n].status == 0) ? 0 : 1;
+		}
+	}
+	return failed;
+}
+
+librc4_prng* librc4_prng_new(const uint8_t* seed, size_t seed_size) {
+	if (!valid_key(seed, seed_size))
+		return NULL;
+	librc4_prng* prng = new (std::nothrow) librc4_prng;
+	if (prng == NULL)
+		return NULL;
+	init_state(&prng->state, seed, seed_size);
+
+	// The first keystream bytes are biased towards the seed, drop them
+	uint8_t scratch[LIBRC4_PRNG_DROP];
+	keystream_state(&prng->state, scratch, sizeof(scratch));
+	prng->used = LIBRC4_PRNG_POOL;
+	return prng;
+}
+
+void librc4_prng_free(librc4_prng* prng) {
+	if (prng != NULL)
+		memset(prng, 0, sizeof(*prng));
+	delete prng;
+}
+
+void librc4_prng_bytes(librc4_prng* prng, uint8_t* out, size_t size) {
+	if (prng == NULL || out == NULL)
+		return;
+
+	// Pool first (keeps the sequence independent of the request sizes), then bulk
+	while (size > 0 && prng->used < LIBRC4_PRNG_POOL) {
+		*out++ = prng->pool[prng->used++];
+		size--;
+	}
+	size_t bulk = size - size % LIBRC4_PRNG_POOL;
+	keystream_state(&prng->state, out, bulk);
+	out += bulk;
+	size -= bulk;
+	if (size > 0) {
+		keystream_state(&prng->state, prng->pool, LIBRC4_PRNG_POOL);
+		memcpy(out, prng->pool, size);
+		prng->used = (uint32_t) size;
+	}
+}
+
+uint32_t librc4_prng_u32(librc4_prng* prng) {
+	uint8_t bytes[4] = { 0 };
+	librc4_prng_bytes(prng, bytes, sizeof(bytes));
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+uint64_t librc4_prng_u64(librc4_prng* prng) {
+	uint64_t low = librc4_prng_u32(prng);
+	return low | ((uint64_t) librc4_prng_u32(prng) << 32);
+}
+
+// Rejection sampling, no modulo bias
+uint32_t librc4_prng_uniform(librc4_prng* prng, uint32_t bound) {
+	if (bound == 0)
+		return 0;
+	uint32_t limit = (uint32_t) (-bound) % bound;
+	for (;;) {
+		uint32_t value = librc4_prng_u32(prng);
+		if (value >= limit)
+			return value % bound;
+	}
+}
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+librc4: C ABI of the C++ engine
+
+One engine for drivers, benchmarks, bindings and services instead of a copy
+of the loop per program. Everything behind this header is C (no C++ types,
+no exceptions cross it), contexts are opaque so the internal layout (S-box
+width, stream threshold, ...) can change without breaking callers.
+
+Versioning: the soname carries LIBRC4_VERSION_MAJOR, which only changes when
+a signature or the behaviour of an existing entry point changes. New entry
+points bump the minor version. Callers can compare the header version with
+librc4_version() of the loaded library.
+
+Build (static and shared, only the librc4_* symbols are exported). The
+archive is one relocatable object with the hidden engine symbols (ksa, prga,
+rc4, rc4_init, ...) made local, so they cannot clash with the caller's:
+	g++ -O2 -fPIC -fvisibility=hidden -c librc4.cpp rc4_engine.cpp rc4_batch.cpp
+	ld -r -o librc4_all.o librc4.o rc4_engine.o rc4_batch.o
+	objcopy --localize-hidden librc4_all.o
+	ar rcs librc4.a librc4_all.o
+	g++ -shared -Wl,-soname,librc4.so.1 -o librc4.so.1.0.0 librc4.o rc4_engine.o rc4_batch.o
+	ln -sf librc4.so.1.0.0 librc4.so.1 && ln -sf librc4.so.1 librc4.so
+
+Link from C with: gcc prog.c -L. -lrc4 (add -lstdc++ for the static archive)
+*/
+
+#ifndef __LIBRC4_H__
+#define __LIBRC4_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LIBRC4_VERSION_MAJOR 1
+#define LIBRC4_VERSION_MINOR 0
+#define LIBRC4_VERSION_PATCH 0
+#define LIBRC4_VERSION ((LIBRC4_VERSION_MAJOR << 16) | (LIBRC4_VERSION_MINOR << 8) | LIBRC4_VERSION_PATCH)
+
+#define LIBRC4_MAX_KEY_SIZE 32
+
+#define LIBRC4_API __attribute__((visibility("default")))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Return codes
+#define LIBRC4_OK 0
+#define LIBRC4_EINVAL -1     // NULL pointer or key size not in 1 .. 32
+#define LIBRC4_ENOMEM -2
+
+// Version of the loaded library, encoded like LIBRC4_VERSION
+LIBRC4_API uint32_t librc4_version(void);
+
+// One shot: out = RC4(key) ^ in, in == out is allowed
+LIBRC4_API int librc4_crypt(const uint8_t* key, size_t key_size, const uint8_t* in, uint8_t* out, size_t size);
+
+// Streaming context: the keystream position survives between calls
+typedef struct librc4_ctx librc4_ctx;
+
+LIBRC4_API librc4_ctx* librc4_ctx_new(const uint8_t* key, size_t key_size);
+LIBRC4_API int librc4_ctx_reset(librc4_ctx* ctx, const uint8_t* key, size_t key_size);
+LIBRC4_API void librc4_ctx_free(librc4_ctx* ctx);
+// in and out either do not overlap at all or are equal (in place)
+LIBRC4_API int librc4_ctx_crypt(librc4_ctx* ctx, const uint8_t* in, uint8_t* out, size_t size);
+LIBRC4_API int librc4_ctx_keystream(librc4_ctx* ctx, uint8_t* out, size_t size);
+LIBRC4_API int librc4_ctx_skip(librc4_ctx* ctx, uint64_t size);
+
+// Batch: independent messages interleaved over the multi-lane engine.
+// in == NULL --> raw keystream. Returns the number of failed jobs.
+typedef struct librc4_job {
+	const uint8_t* key;
+	size_t key_size;
+	const uint8_t* in;
+	uint8_t* out;
+	uint64_t size;
+	int status;          // set per job, LIBRC4_OK or LIBRC4_EINVAL
+} librc4_job;
+
+LIBRC4_API int librc4_batch(librc4_job* jobs, size_t job_count);
+
+// Deterministic PRNG (RC4-drop[3072]) for test data, shuffles and
+// simulations. Same seed --> same sequence on every platform. Not a CSPRNG.
+typedef struct librc4_prng librc4_prng;
+
+LIBRC4_API librc4_prng* librc4_prng_new(const uint8_t* seed, size_t seed_size);
+LIBRC4_API void librc4_prng_free(librc4_prng* prng);
+LIBRC4_API void librc4_prng_bytes(librc4_prng* prng, uint8_t* out, size_t size);
+LIBRC4_API uint32_t librc4_prng_u32(librc4_prng* prng);
+LIBRC4_API uint64_t librc4_prng_u64(librc4_prng* prng);
+// Uniform in [0, bound), bound == 0 --> 0
+LIBRC4_API uint32_t librc4_prng_uniform(librc4_prng* prng, uint32_t bound);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+librc4 example and ABI check, plain C on purpose
+
+Compile with these commands (after building librc4, see librc4.h):
+	gcc -O2 -o librc4_example librc4_example.c -L. -lrc4 && LD_LIBRARY_PATH=. ./librc4_example
+	gcc -O2 -o librc4_example librc4_example.c librc4.a -lstdc++ && ./librc4_example
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "librc4.h"
+
+int main(void)
+{
+	int error = 0;
+	const size_t plaintext_size = 32;
+
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[32] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+
+	// 3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595
+	uint8_t plaintext[32] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2,
+			0xe0, 0xf8, 0x51, 0x2c, 0xb3, 0x5a, 0x75, 0x79,
+			0xfd, 0x79, 0x57, 0x5c, 0xf2, 0x87, 0xc5, 0x95
+	};
+
+	// 2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179
+	uint8_t known_ciphertext[32] = {
+			0x22, 0x80, 0xc9, 0x67, 0x6c, 0x8f, 0x5c, 0x52,
+			0xab, 0xa8, 0xd4, 0x26, 0x11, 0xf8, 0x5e, 0x7c,
+			0xa9, 0x61, 0xa2, 0x11, 0x7d, 0x3c, 0xfc, 0x82,
+			0x36, 0xa6, 0x05, 0x1b, 0xbf, 0xc5, 0xf1, 0x79
+	};
+
+	uint8_t ciphertext[32] = {0};
+	uint8_t buffer[32] = {0};
+	uint32_t version = librc4_version();
+
+	printf("[*] librc4 header %d.%d.%d, library %u.%u.%u\n",
+			LIBRC4_VERSION_MAJOR, LIBRC4_VERSION_MINOR, LIBRC4_VERSION_PATCH,
+			version >> 16, (version >> 8) & 0xff, version & 0xff);
+	if ((version >> 16) != LIBRC4_VERSION_MAJOR) {
+		printf("[!] The library has a different major version!\n");
+		return 1;
+	}
+
+	// One shot
+	if (librc4_crypt(key, 32, plaintext, ciphertext, plaintext_size) != LIBRC4_OK || memcmp(ciphertext, known_ciphertext, plaintext_size) != 0) {
+		printf("[!] librc4_crypt() does not match the known ciphertext!\n");
+		error++;
+	}
+
+	// Context, in uneven pieces and in place
+	librc4_ctx* ctx = librc4_ctx_new(key, 32);
+	memcpy(buffer, plaintext, plaintext_size);
+	librc4_ctx_crypt(ctx, buffer, buffer, 5);
+	librc4_ctx_crypt(ctx, buffer + 5, buffer + 5, 20);
+	librc4_ctx_crypt(ctx, buffer + 25, buffer + 25, 7);
+	if (memcmp(buffer, known_ciphertext, plaintext_size) != 0) {
+		printf("[!] librc4_ctx_crypt() does not match the known ciphertext!\n");
+		error++;
+	}
+
+	// Keystream and skip
+	librc4_ctx_reset(ctx, key, 32);
+	librc4_ctx_skip(ctx, 16);
+	librc4_ctx_keystream(ctx, buffer, 16);
+	for (size_t n = 0; n < 16; n++) {
+		if ((buffer[n] ^ plaintext[16 + n]) != known_ciphertext[16 + n]) {
+			printf("[!] librc4_ctx_skip() / librc4_ctx_keystream() do not match the known ciphertext!\n");
+			error++;
+			break;
+		}
+	}
+	librc4_ctx_free(ctx);
+
+	// Batch: more jobs than lanes, one invalid key
+	librc4_job jobs[6];
+	uint8_t outputs[6][32];
+	for (int n = 0; n < 6; n++) {
+		jobs[n].key = key;
+		jobs[n].key_size = (n == 3) ? 0 : 32;
+		jobs[n].in = plaintext;
+		jobs[n].out = outputs[n];
+		jobs[n].size = plaintext_size;
+	}
+	int failed = librc4_batch(jobs, 6);
+	for (int n = 0; n < 6; n++) {
+		if (n != 3 && (jobs[n].status != LIBRC4_OK || memcmp(outputs[n], known_ciphertext, plaintext_size) != 0))
+			error++;
+	}
+	if (failed != 1 || jobs[3].status != LIBRC4_EINVAL) {
+		printf("[!] librc4_batch() reported the wrong jobs!\n");
+		error++;
+	}
+
+	// PRNG: same seed --> same sequence, independent of the request sizes
+	librc4_prng* first = librc4_prng_new(key, 32);
+	librc4_prng* second = librc4_prng_new(key, 32);
+	uint8_t bulk[200];
+	uint8_t pieces[200];
+	librc4_prng_bytes(first, bulk, sizeof(bulk));
+	for (size_t n = 0; n < sizeof(pieces); n += 7)
+		librc4_prng_bytes(second, pieces + n, (sizeof(pieces) - n < 7) ? sizeof(pieces) - n : 7);
+	if (memcmp(bulk, pieces, sizeof(bulk)) != 0) {
+		printf("[!] librc4_prng_bytes() depends on the request sizes!\n");
+		error++;
+	}
+	for (int n = 0; n < 1000; n++) {
+		if (librc4_prng_uniform(first, 10) >= 10) {
+			printf("[!] librc4_prng_uniform() is out of range!\n");
+			error++;
+			break;
+		}
+	}
+	librc4_prng_free(first);
+	librc4_prng_free(second);
+
+	// Invalid input
+	if (librc4_ctx_new(key, 33) != NULL || librc4_crypt(NULL, 32, plaintext, ciphertext, plaintext_size) != LIBRC4_EINVAL) {
+		printf("[!] Invalid keys are accepted!\n");
+		error++;
+	}
+
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	printf(error == 0 ? "[*] ... PASSED ...\n" : "[!] ... FAILED ...\n");
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	return error;
+}
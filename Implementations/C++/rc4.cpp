@@ -25,36 +25,108 @@ SOFTWARE.
 
 /*
 Compile with this command:
-	g++ -O1 -o rc4 rc4.cpp && ./rc4
+	g++ -O1 -o rc4 rc4.cpp rc4_engine.cpp rc4_perf.cpp rc4_arena.cpp && ./rc4
+
+Add -p to read the hardware performance counters around the KSA and PRGA
+phases of the speed test.
+
+Vector mode (used by ../rc4_crossbench.py, skips the self-test and speed test):
+	./rc4 -k key.bin -i plaintext.bin -o ciphertext.bin
 */
 
 #include <chrono>
 #include <iostream>
+#include <vector>
 #include <stdio.h>
 #include <cstring>
-
-#define N 256
+#include "rc4.h"
+#include "rc4_perf.h"
+#include "rc4_energy.h"
+#include "rc4_arena.h"
 
 using namespace std;
 
-void rc4(
-	uint16_t key_size_in,
-	uint32_t plaintext_size_in,
-	uint8_t* key_in,
-	uint8_t* plaintext_in,
-	uint8_t* ciphertext_out
-);
+#define RC4_PERF_KSA_RUNS 10000
+
+
+static int read_file(const char* path, vector<uint8_t>& data) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return 1;
+	uint8_t chunk[65536];
+	size_t received = 0;
+	data.clear();
+	while ((received = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		data.insert(data.end(), chunk, chunk + received);
+	fclose(file);
+	return 0;
+}
 
-void swap(uint8_t* a, uint8_t* b);
-int ksa(uint8_t* S, uint8_t* key, uint16_t key_size);
-int prga(uint8_t* S, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size);
+// Encrypts the given files, the KSA (setup) and the PRGA are timed separately
+static int run_vector(const char* key_path, const char* plaintext_path, const char* ciphertext_path) {
+	vector<uint8_t> key;
+	vector<uint8_t> plaintext;
+	if (read_file(key_path, key) != 0 || read_file(plaintext_path, plaintext) != 0) {
+		printf("[!] Could not read the key / plaintext file!\n");
+		return 1;
+	}
+	vector<uint8_t> ciphertext(plaintext.size());
+
+	// The S-box width calibration runs once per process, keep it out of the timed region
+	rc4_width();
+	rc4_ctx ctx;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	if (rc4_init(&ctx, key.data(), key.size()) != 0)
+		return 1;
+	std::chrono::steady_clock::time_point setup = std::chrono::steady_clock::now();
+	rc4_crypt(&ctx, plaintext.data(), ciphertext.data(), plaintext.size());
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
+	FILE* file = fopen(ciphertext_path, "wb");
+	if (file == NULL || fwrite(ciphertext.data(), 1, ciphertext.size(), file) != ciphertext.size()) {
+		printf("[!] Could not write the ciphertext file!\n");
+		if (file != NULL)
+			fclose(file);
+		return 1;
+	}
+	fclose(file);
+	printf("[*] Vector: %zu byte in %.6f seconds (setup %.6f seconds)\n", plaintext.size(),
+		std::chrono::duration<double>(end - setup).count(), std::chrono::duration<double>(setup - begin).count());
+	return 0;
+}
 
-int main()
+int main(int argc, char** argv)
 {
 	// Variable Definition
 	int i = 0;
 	int error = 0;
+	bool perf_counters = false;
+	const char* key_path = NULL;
+	const char* plaintext_path = NULL;
+	const char* ciphertext_path = NULL;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-p") == 0) { perf_counters = true; }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-i") == 0) && (i < (argc - 1))) { plaintext_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-o") == 0) && (i < (argc - 1))) { ciphertext_path = argv[++i]; }
+		else {
+			printf("[*] Application usage:\n");
+			printf("  -p           : report hardware performance counters for the speed test\n");
+			printf("  -k <file>    : vector mode, binary key (1 - 32 byte)\n");
+			printf("  -i <file>    : vector mode, binary plaintext\n");
+			printf("  -o <file>    : vector mode, binary ciphertext output\n");
+			return 1;
+		}
+	}
+
+	if (key_path != NULL || plaintext_path != NULL || ciphertext_path != NULL) {
+		if (key_path == NULL || plaintext_path == NULL || ciphertext_path == NULL) {
+			printf("[!] Vector mode needs -k, -i and -o!\n");
+			return 1;
+		}
+		return run_vector(key_path, plaintext_path, ciphertext_path);
+	}
 
 	const uint16_t key_size = 32;
 	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
@@ -121,6 +193,20 @@ int main()
 	}
 	printf("\n");
 
+	// Context API: out-of-place in one call and in place in two pieces
+	rc4_ctx ctx;
+	uint8_t ctx_ciphertext[plaintext_size] = {0};
+	rc4_init(&ctx, key, key_size);
+	rc4_crypt(&ctx, plaintext, ctx_ciphertext, plaintext_size);
+	memcpy(ciphertext, plaintext, plaintext_size);
+	rc4_init(&ctx, key, key_size);
+	encrypt_inplace(&ctx, ciphertext, 13);
+	encrypt_inplace(&ctx, ciphertext + 13, plaintext_size - 13);
+	if (memcmp(ctx_ciphertext, known_ciphertext, plaintext_size) != 0 || memcmp(ciphertext, known_ciphertext, plaintext_size) != 0) {
+		printf("[!] rc4_crypt() / encrypt_inplace() do not match the known ciphertext!\n");
+		error += 1;
+	}
+
 	// Print PASS / FAIL
 	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
 	if (error == 0) {
@@ -138,9 +224,18 @@ int main()
 	printf("[*] ... SPEED TEST ...\n");
 	// Reuse key
 	const uint32_t plaintext_size_speed_test = 1024 * 1000 * 50; // 50 Megabyte
-	uint8_t* plaintext_speed_test = (uint8_t*) malloc(plaintext_size_speed_test);
+	rc4_buffer plaintext_buffer;
+	rc4_buffer ciphertext_buffer;
+	if (rc4_buffer_alloc(&plaintext_buffer, plaintext_size_speed_test) != 0 || rc4_buffer_alloc(&ciphertext_buffer, plaintext_size_speed_test) != 0)
+		return 1;
+	printf("[*] Buffers: %s\n", rc4_buffer_pages(&plaintext_buffer));
+	uint8_t* plaintext_speed_test = plaintext_buffer.data;
 	memset(plaintext_speed_test, 'a', (size_t) plaintext_size_speed_test);
-	uint8_t* ciphertext_test = (uint8_t*) malloc(plaintext_size_speed_test);
+	uint8_t* ciphertext_test = ciphertext_buffer.data;
+	memset(ciphertext_test, 0, (size_t) plaintext_size_speed_test);
+	rc4_energy energy;
+	rc4_energy_open(&energy);
+	rc4_energy_start(&energy);
 	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 	rc4(
 		key_size,
@@ -149,6 +244,7 @@ int main()
 		plaintext_speed_test,
 		ciphertext_test);
 	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	rc4_energy_stop(&energy);
 	/*
 	// For 50 MB --> 658b79745390f3ccd8242c9d0178a018add82ba8d0058adf9dfb3a2b02d188a3
 	printf("[*] Ciphertext (last 32 byte):  0x");
@@ -157,69 +253,55 @@ int main()
 	}
 	printf("\n");
 	*/
-	free(plaintext_speed_test);
-	free(ciphertext_test);
+	// Hardware counters: separate KSA / PRGA runs, the timed rc4() run above stays unaffected
+	rc4_perf perf;
+	if (perf_counters && rc4_perf_open(&perf) == 0) {
+		// One KSA is only a few hundred cycles --> measure RC4_PERF_KSA_RUNS of them
+		uint8_t array_s[N];
+		char label[64];
+		rc4_perf_start(&perf);
+		for (int run = 0; run < RC4_PERF_KSA_RUNS; run++)
+			ksa(array_s, key, key_size);
+		rc4_perf_stop(&perf);
+		snprintf(label, sizeof(label), "KSA (%d runs)", RC4_PERF_KSA_RUNS);
+		rc4_perf_print(&perf, label, (uint64_t) RC4_PERF_KSA_RUNS * N);
+		rc4_perf_start(&perf);
+		prga(array_s, plaintext_speed_test, ciphertext_test, plaintext_size_speed_test);
+		rc4_perf_stop(&perf);
+		rc4_perf_print(&perf, "PRGA", plaintext_size_speed_test);
+		rc4_perf_close(&perf);
+	}
 	float time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
 	printf("[*] Encrypted %d MB in %.2f seconds (%.2f MB/s)\n", (plaintext_size_speed_test/(1024 * 1000)), float(time_ms/1000), float((plaintext_size_speed_test / (1024 * 1000)) / float(time_ms/1000)));
-
-	return 0;
-}
-
-void rc4(
-	uint16_t key_size_in,
-	uint32_t plaintext_size_in,
-	uint8_t* key_in,
-	uint8_t* plaintext_in,
-	uint8_t* ciphertext_out) {
-
-	// Variable Declaration
-	uint8_t array_s[N] = { 0 };
-	int i = 0;
-
-	// Input Validation
-	if (key_size_in == 0 || key_size_in > 32) {
-		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!");
-		return;
-	}
-
-	// KSA - Key Scheduling Algorithm
-	ksa(array_s, key_in, key_size_in);
-
-	// PRGA - Pseudo Random Generation Algorithm
-	prga(array_s, plaintext_in, ciphertext_out, plaintext_size_in);
-}
-
-void swap(uint8_t* a, uint8_t* b) {
-	uint8_t tmp = *a;
-	*a = *b;
-	*b = tmp;
-}
-
-int ksa(uint8_t* array_s, uint8_t* key, uint16_t key_size) {
-	int j = 0;
-	int i = 0;
-
-	for (i = 0; i < N; i++)
-		array_s[i] = i;
-
-	for (i = 0; i < N; i++) {
-		j = (j + array_s[i] + key[i % key_size]) % N;
-		swap(&array_s[i], &array_s[j]);
+	rc4_energy_print(&energy, plaintext_size_speed_test);
+
+	// rc4_crypt(): cached stores vs non-temporal stores (auto selected from the threshold on)
+	rc4_buffer stream_buffer;
+	if (rc4_buffer_alloc(&stream_buffer, plaintext_size_speed_test) == 0) {
+		rc4_ctx ctx;
+		memset(stream_buffer.data, 0, plaintext_size_speed_test);
+		rc4_init(&ctx, key, key_size);
+		begin = std::chrono::steady_clock::now();
+		rc4_crypt_cached(&ctx, plaintext_speed_test, ciphertext_test, plaintext_size_speed_test);
+		end = std::chrono::steady_clock::now();
+		double cached_seconds = std::chrono::duration<double>(end - begin).count();
+		rc4_init(&ctx, key, key_size);
+		begin = std::chrono::steady_clock::now();
+		rc4_crypt_stream(&ctx, plaintext_speed_test, stream_buffer.data, plaintext_size_speed_test);
+		end = std::chrono::steady_clock::now();
+		double stream_seconds = std::chrono::duration<double>(end - begin).count();
+
+		printf("[*] rc4_crypt() cached stores (%d byte S-box elements): %.2f MB/s, streaming stores: %.2f MB/s (threshold %llu byte)\n",
+			rc4_width(),
+			(plaintext_size_speed_test / (1024.0 * 1000)) / cached_seconds,
+			(plaintext_size_speed_test / (1024.0 * 1000)) / stream_seconds,
+			(unsigned long long) rc4_stream_threshold());
+		if (memcmp(ciphertext_test, stream_buffer.data, plaintext_size_speed_test) != 0)
+			printf("[!] The streaming store output does not match the cached output!\n");
+		rc4_buffer_free(&stream_buffer);
 	}
-	return 0;
-}
 
-int prga(uint8_t* array_s, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size) {
-	uint32_t i = 0;
-	uint32_t j = 0;
-	uint8_t keystream_byte = 0;
-
-	for (uint32_t n = 0; n < plaintext_size; n++) {
-		i = (i + 1) % N;
-		j = (j + array_s[i]) % N;
-		swap(&array_s[i], &array_s[j]);
-		keystream_byte = array_s[(array_s[i] + array_s[j]) % N];
-		ciphertext[n] = keystream_byte ^ plaintext[n];
-	}
+	rc4_buffer_free(&plaintext_buffer);
+	rc4_buffer_free(&ciphertext_buffer);
 	return 0;
 }
@@ -0,0 +1,197 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __RC4_H__
+#define __RC4_H__
+
+#include <stdint.h>
+
+constexpr uint32_t N = 256;  // 2^8, default state size (see ksa_n() / prga_n() for reduced states)
+#define KSA_MAX_KEY_SIZE 32
+
+// Index arithmetic modulo the state size, a mask for powers of two
+template <uint32_t SN>
+static inline uint32_t rc4_mod(uint32_t x) {
+	static_assert(SN >= 2 && SN <= 256, "the state has to fit into uint8_t words");
+	if constexpr ((SN & (SN - 1)) == 0)
+		return x & (SN - 1);
+	else
+		return x % SN;
+}
+
+// KSA with prefix memoization: the state after the first d KSA iterations
+// only depends on key[0 .. d-1], so keys sharing a prefix with the previous
+// key (IV || key layouts, lexicographic enumeration) restore that snapshot
+// and only run the remaining iterations.
+struct ksa_prefix_state {
+	uint8_t key[KSA_MAX_KEY_SIZE];
+	uint16_t key_size;
+	uint16_t valid;                             // levels[0 .. valid] hold snapshots
+	uint8_t j[KSA_MAX_KEY_SIZE];
+	uint8_t levels[KSA_MAX_KEY_SIZE][N];        // S after d iterations (level 0 --> identity)
+};
+
+void rc4(
+	uint16_t key_size_in,
+	uint32_t plaintext_size_in,
+	uint8_t* key_in,
+	uint8_t* plaintext_in,
+	uint8_t* ciphertext_out
+);
+
+void swap(uint8_t* a, uint8_t* b);
+int ksa(uint8_t* S, uint8_t* key, uint16_t key_size);
+void ksa_prefix_init(ksa_prefix_state* state, uint16_t key_size);
+int ksa_prefix(ksa_prefix_state* state, uint8_t* S, uint8_t* key);
+int prga(uint8_t* S, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size);
+int prga_keystream(uint8_t* S, uint8_t* keystream, uint32_t keystream_size);
+uint32_t prga_compare(uint8_t* S, uint8_t* keystream, uint32_t keystream_size);
+
+// State size templates for reduced RC4 (N = 16, 32, 64, ...): S is a
+// permutation of 0 .. SN-1 and every keystream word is below SN
+template <uint32_t SN>
+int ksa_n(uint8_t* array_s, uint8_t* key, uint16_t key_size) {
+	uint32_t j = 0;
+	uint32_t i = 0;
+	uint8_t tmp = 0;
+
+	for (i = 0; i < SN; i++)
+		array_s[i] = i;
+
+	for (i = 0; i < SN; i++) {
+		j = rc4_mod<SN>(j + array_s[i] + key[i % key_size]);
+		tmp = array_s[i];
+		array_s[i] = array_s[j];
+		array_s[j] = tmp;
+	}
+	return 0;
+}
+
+template <uint32_t SN>
+int prga_keystream_n(uint8_t* array_s, uint8_t* keystream, uint32_t keystream_size) {
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint8_t tmp = 0;
+
+	for (uint32_t n = 0; n < keystream_size; n++) {
+		i = rc4_mod<SN>(i + 1);
+		j = rc4_mod<SN>(j + array_s[i]);
+		tmp = array_s[i];
+		array_s[i] = array_s[j];
+		array_s[j] = tmp;
+		keystream[n] = array_s[rc4_mod<SN>(array_s[i] + array_s[j])];
+	}
+	return 0;
+}
+
+template <uint32_t SN>
+int prga_n(uint8_t* array_s, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size) {
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint8_t tmp = 0;
+
+	for (uint32_t n = 0; n < plaintext_size; n++) {
+		i = rc4_mod<SN>(i + 1);
+		j = rc4_mod<SN>(j + array_s[i]);
+		tmp = array_s[i];
+		array_s[i] = array_s[j];
+		array_s[j] = tmp;
+		ciphertext[n] = array_s[rc4_mod<SN>(array_s[i] + array_s[j])] ^ plaintext[n];
+	}
+	return 0;
+}
+
+// RC4A (Paul / Preneel): two S-boxes, two keystream bytes per round
+int rc4a_ksa(uint8_t* S1, uint8_t* S2, uint8_t* key, uint16_t key_size);
+int rc4a_prga(uint8_t* S1, uint8_t* S2, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size);
+
+// Streaming context: i / j survive between calls, so a message can be
+// processed in pieces (64 bit lengths, no 4 GiB limit). Aliasing contract:
+//  - encrypt_inplace(): buf is read and overwritten byte by byte
+//  - rc4_crypt(): in and out must not overlap at all, use encrypt_inplace()
+//    for in == out (partial overlap is never allowed)
+//  - ctx must not be part of any buffer
+// The restrict qualifiers let the compiler keep S[i] / S[j] in registers
+// across the output store. rc4() / prga() make no such assumptions.
+struct rc4_ctx {
+	uint8_t S[N];
+	uint32_t i;
+	uint32_t j;
+};
+
+int rc4_init(rc4_ctx* ctx, uint8_t* key, uint16_t key_size);
+void encrypt_inplace(rc4_ctx* __restrict ctx, uint8_t* __restrict buf, uint64_t len);
+void rc4_crypt(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len);
+
+// rc4_crypt() switches to non-temporal (streaming) stores with input
+// prefetching from rc4_stream_threshold() bytes on (the last level cache size,
+// RC4_STREAM_THRESHOLD at compile time overrides it), so large outputs do not
+// evict the S-box and other cached data. Both paths are exported for benchmarks.
+uint64_t rc4_stream_threshold();
+void rc4_crypt_cached(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len);
+void rc4_crypt_stream(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len);
+
+// S-box element width for the cached kernel: byte loads / stores can cause
+// partial register merges and store forwarding stalls on some cores, 16 or
+// 32 bit elements avoid them at 2x / 4x the S-box footprint. The state is
+// widened into a local copy per call (256 elements) and narrowed back.
+template <typename T>
+void rc4_crypt_w(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len) {
+	T wide_s[sizeof(T) == 1 ? 1 : N];
+	T* __restrict array_s = wide_s;
+	uint32_t i = ctx->i;
+	uint32_t j = ctx->j;
+
+	if constexpr (sizeof(T) == 1) {
+		array_s = ctx->S;
+	}
+	else {
+		for (uint32_t k = 0; k < N; k++)
+			wide_s[k] = ctx->S[k];
+	}
+
+	for (uint64_t n = 0; n < len; n++) {
+		i = (i + 1) % N;
+		T si = array_s[i];
+		j = (j + si) % N;
+		T sj = array_s[j];
+		array_s[i] = sj;
+		array_s[j] = si;
+		out[n] = in[n] ^ (uint8_t) array_s[(si + sj) % N];
+	}
+
+	if constexpr (sizeof(T) > 1) {
+		for (uint32_t k = 0; k < N; k++)
+			ctx->S[k] = (uint8_t) wide_s[k];
+	}
+	ctx->i = i;
+	ctx->j = j;
+}
+
+// Element width (1, 2 or 4 byte) used by rc4_crypt_cached(), picked by
+// timing all three once on first use. rc4_set_width() overrides the choice.
+int rc4_width();
+int rc4_set_width(int width);
+
+#endif
@@ -0,0 +1,190 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <stdio.h>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "rc4_arena.h"
+
+static size_t mapped_size(size_t size) {
+	size_t page = (size >= RC4_ARENA_HUGE_PAGE) ? RC4_ARENA_HUGE_PAGE : (size_t) sysconf(_SC_PAGESIZE);
+	return (size + page - 1) / page * page;
+}
+
+int rc4_buffer_alloc(rc4_buffer* buffer, size_t size) {
+	memset(buffer, 0, sizeof(rc4_buffer));
+	if (size == 0)
+		return 1;
+
+	buffer->size = size;
+	buffer->mapped = mapped_size(size);
+
+	if (size < RC4_ARENA_HUGE_PAGE) {
+		void* map = mmap(NULL, buffer->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (map == MAP_FAILED) {
+			printf("[!] Could not allocate %zu byte!\n", size);
+			return 1;
+		}
+		buffer->data = (uint8_t*) map;
+		buffer->pages = RC4_PAGES_DEFAULT;
+		return 0;
+	}
+
+	// Explicit huge pages (fails without a hugetlbfs reserve)
+	void* map = mmap(NULL, buffer->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (map != MAP_FAILED) {
+		buffer->data = (uint8_t*) map;
+		buffer->pages = RC4_PAGES_HUGETLB;
+		return 0;
+	}
+
+	// Transparent huge pages: over-allocate by one huge page and trim to a 2 MiB aligned range
+	size_t reserve = buffer->mapped + RC4_ARENA_HUGE_PAGE;
+	map = mmap(NULL, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		printf("[!] Could not allocate %zu byte!\n", size);
+		return 1;
+	}
+	uintptr_t start = (uintptr_t) map;
+	uintptr_t aligned = (start + RC4_ARENA_HUGE_PAGE - 1) & ~((uintptr_t) RC4_ARENA_HUGE_PAGE - 1);
+	if (aligned > start)
+		munmap(map, aligned - start);
+	if (start + reserve > aligned + buffer->mapped)
+		munmap((void*) (aligned + buffer->mapped), start + reserve - (aligned + buffer->mapped));
+
+	buffer->data = (uint8_t*) aligned;
+	buffer->pages = (madvise(buffer->data, buffer->mapped, MADV_HUGEPAGE) == 0) ? RC4_PAGES_TRANSPARENT : RC4_PAGES_DEFAULT;
+	return 0;
+}
+
+void rc4_buffer_free(rc4_buffer* buffer) {
+	if (buffer->data != NULL)
+		munmap(buffer->data, buffer->mapped);
+	memset(buffer, 0, sizeof(rc4_buffer));
+}
+
+const char* rc4_buffer_pages(const rc4_buffer* buffer) {
+	switch (buffer->pages) {
+	case RC4_PAGES_HUGETLB: return "explicit 2 MiB pages";
+	case RC4_PAGES_TRANSPARENT: return "transparent huge pages";
+	default: return "default pages";
+	}
+}
+
+
+rc4_slab_pool::~rc4_slab_pool() {
+	for (rc4_buffer& slab : slabs)
+		rc4_buffer_free(&slab);
+}
+
+static uint32_t size_class(size_t size) {
+	uint32_t shift = RC4_POOL_MIN_SHIFT;
+	while (((size_t) 1 << shift) < size)
+		shift++;
+	return shift - RC4_POOL_MIN_SHIFT;
+}
+
+void rc4_slab_pool_init(rc4_slab_pool* pool, uint32_t max_shift, rc4_slab_alloc slab_alloc, void* slab_context, std::mutex* lock) {
+	pool->max_shift = (max_shift > RC4_SLAB_POOL_MAX_SHIFT) ? RC4_SLAB_POOL_MAX_SHIFT : max_shift;
+	pool->slab_alloc = slab_alloc;
+	pool->slab_context = slab_context;
+	pool->lock = lock;
+}
+
+// Free list first, otherwise carved from the current slab (called with the pool lock held)
+static void* slab_pool_take(rc4_slab_pool* pool, uint32_t c) {
+	if (pool->free_list[c] != NULL) {
+		void* block = pool->free_list[c];
+		pool->free_list[c] = *(void**) block;
+		return block;
+	}
+
+	// Slabs are at least one huge page, blocks above that get a slab of their own size
+	size_t block_size = (size_t) 1 << (c + RC4_POOL_MIN_SHIFT);
+	if (pool->remaining < block_size) {
+		rc4_buffer slab;
+		size_t slab_size = (block_size > RC4_ARENA_HUGE_PAGE) ? block_size : RC4_ARENA_HUGE_PAGE;
+		int status = (pool->slab_alloc != NULL) ? pool->slab_alloc(&slab, slab_size, pool->slab_context) : rc4_buffer_alloc(&slab, slab_size);
+		if (status != 0)
+			return NULL;
+		pool->slabs.push_back(slab);
+		pool->cursor = slab.data;
+		pool->remaining = slab.mapped;
+	}
+	void* block = pool->cursor;
+	pool->cursor += block_size;
+	pool->remaining -= block_size;
+	return block;
+}
+
+void* rc4_slab_pool_alloc(rc4_slab_pool* pool, size_t size) {
+	if (size == 0 || size > ((size_t) 1 << pool->max_shift))
+		return NULL;
+
+	uint32_t c = size_class(size);
+	if (pool->lock == NULL)
+		return slab_pool_take(pool, c);
+	std::lock_guard<std::mutex> guard(*pool->lock);
+	return slab_pool_take(pool, c);
+}
+
+void rc4_slab_pool_free(rc4_slab_pool* pool, void* block, size_t size) {
+	if (block == NULL)
+		return;
+	uint32_t c = size_class(size);
+	if (pool->lock != NULL)
+		pool->lock->lock();
+	*(void**) block = pool->free_list[c];
+	pool->free_list[c] = block;
+	if (pool->lock != NULL)
+		pool->lock->unlock();
+}
+
+static thread_local rc4_slab_pool pool;
+
+void* rc4_pool_alloc(size_t size) {
+	if (size == 0)
+		return NULL;
+
+	// Larger than the biggest class --> dedicated huge page mapping
+	if (size > ((size_t) 1 << RC4_POOL_MAX_SHIFT)) {
+		rc4_buffer buffer;
+		if (rc4_buffer_alloc(&buffer, size) != 0)
+			return NULL;
+		return buffer.data;
+	}
+	return rc4_slab_pool_alloc(&pool, size);
+}
+
+void rc4_pool_free(void* block, size_t size) {
+	if (block == NULL)
+		return;
+	if (size > ((size_t) 1 << RC4_POOL_MAX_SHIFT)) {
+		munmap(block, mapped_size(size));
+		return;
+	}
+	rc4_slab_pool_free(&pool, block, size);
+}
@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Huge page backed buffers and per-thread pools
+
+rc4_buffer is for large buffers (speed tests, multi-GB inputs): sizes from
+2 MiB up are backed by explicit huge pages (MAP_HUGETLB) when the system has
+a reserve (vm.nr_hugepages), otherwise by a 2 MiB aligned mapping with
+MADV_HUGEPAGE so transparent huge pages can back it.
+
+rc4_slab_pool is the size class pool behind both pool flavours: power of two
+classes from 64 byte up to 2^max_shift byte carved out of slabs (at least
+one huge page), freed blocks go onto a per class free list. The slab
+allocator and the lock are pluggable, a pool without a lock must only be
+used by one thread. All returned pointers are 64 byte (cache line) aligned.
+
+rc4_pool_alloc() / rc4_pool_free() serve short-lived objects (job arrays,
+per call state) from an unlocked rc4_slab_pool owned by the calling thread,
+classes up to 2 MiB, larger requests get their own rc4_buffer. A block has
+to be freed by the thread that allocated it and must not outlive that
+thread. rc4_numa_pool (rc4_numa.h) is the locked, node bound variant.
+*/
+
+#ifndef __RC4_ARENA_H__
+#define __RC4_ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#define RC4_ARENA_ALIGNMENT 64
+#define RC4_ARENA_HUGE_PAGE (2 * 1024 * 1024)
+#define RC4_POOL_MIN_SHIFT 6        // 64 byte
+#define RC4_POOL_MAX_SHIFT 21       // 2 MiB, larger requests get their own rc4_buffer
+#define RC4_SLAB_POOL_MAX_SHIFT 29  // 512 MiB, upper bound for max_shift
+#define RC4_SLAB_POOL_CLASSES (RC4_SLAB_POOL_MAX_SHIFT - RC4_POOL_MIN_SHIFT + 1)
+
+enum rc4_pages {
+	RC4_PAGES_DEFAULT = 0,
+	RC4_PAGES_TRANSPARENT,
+	RC4_PAGES_HUGETLB
+};
+
+struct rc4_buffer {
+	uint8_t* data;
+	size_t size;
+	size_t mapped;
+	int pages;      // rc4_pages
+};
+
+// Returns 0 on success
+int rc4_buffer_alloc(rc4_buffer* buffer, size_t size);
+void rc4_buffer_free(rc4_buffer* buffer);
+const char* rc4_buffer_pages(const rc4_buffer* buffer);
+
+// Allocates one slab of size byte, context is the pool's slab_context
+typedef int (*rc4_slab_alloc)(rc4_buffer* slab, size_t size, void* context);
+
+struct rc4_slab_pool {
+	rc4_slab_alloc slab_alloc = NULL;   // NULL --> rc4_buffer_alloc()
+	void* slab_context = NULL;
+	std::mutex* lock = NULL;            // NULL --> owned by one thread
+	uint32_t max_shift = RC4_POOL_MAX_SHIFT;
+	std::vector<rc4_buffer> slabs;
+	uint8_t* cursor = NULL;
+	size_t remaining = 0;
+	void* free_list[RC4_SLAB_POOL_CLASSES] = { NULL };
+
+	~rc4_slab_pool();
+};
+
+void rc4_slab_pool_init(rc4_slab_pool* pool, uint32_t max_shift, rc4_slab_alloc slab_alloc, void* slab_context, std::mutex* lock);
+void* rc4_slab_pool_alloc(rc4_slab_pool* pool, size_t size);    // NULL above 2^max_shift
+void rc4_slab_pool_free(rc4_slab_pool* pool, void* block, size_t size);
+
+void* rc4_pool_alloc(size_t size);
+void rc4_pool_free(void* block, size_t size);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include "rc4_batch.h"
+#include "rc4.h"
+#include "rc4_trace.h"
+
+struct rc4_lane {
+	uint8_t array_s[N];
+	uint32_t i;
+	uint32_t j;
+	uint64_t n;
+	rc4_job* job;
+};
+
+static inline void lane_step(rc4_lane* lane) {
+	uint8_t* array_s = lane->array_s;
+	uint8_t tmp = 0;
+	uint8_t keystream_byte = 0;
+
+	lane->i = (lane->i + 1) % N;
+	lane->j = (lane->j + array_s[lane->i]) % N;
+	tmp = array_s[lane->i];
+	array_s[lane->i] = array_s[lane->j];
+	array_s[lane->j] = tmp;
+	keystream_byte = array_s[(array_s[lane->i] + array_s[lane->j]) % N];
+
+	rc4_job* job = lane->job;
+	if (job->plaintext != NULL)
+		keystream_byte ^= job->plaintext[lane->n];
+	job->ciphertext[lane->n] = keystream_byte;
+	lane->n++;
+}
+
+// Loads the next valid job into the lane, returns 0 if the job list is exhausted
+static int lane_load(rc4_lane* lane, rc4_job* jobs, uint32_t job_count, uint32_t* next, int* failed) {
+	while (*next < job_count) {
+		rc4_job* job = &jobs[(*next)++];
+
+		// Input Validation
+		if (job->key_size == 0 || job->key_size > 32) {
+			printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+			job->status = 1;
+			(*failed)++;
+			continue;
+		}
+		job->status = 0;
+		if (job->size == 0)
+			continue;
+
+		ksa(lane->array_s, job->key, job->key_size);
+		lane->i = 0;
+		lane->j = 0;
+		lane->n = 0;
+		lane->job = job;
+		return 1;
+	}
+	return 0;
+}
+
+int rc4_batch(rc4_job* jobs, uint32_t job_count) {
+	rc4_lane lanes[RC4_BATCH_LANES];
+	rc4_lane* active[RC4_BATCH_LANES];
+	uint32_t active_count = 0;
+	uint32_t next = 0;
+	int failed = 0;
+	uint32_t l = 0;
+
+	RC4_TRACE1(batch_entry, job_count);
+
+	for (l = 0; l < RC4_BATCH_LANES; l++) {
+		if (lane_load(&lanes[l], jobs, job_count, &next, &failed))
+			active[active_count++] = &lanes[l];
+	}
+
+	while (active_count > 0) {
+		// Run all active lanes in lockstep until the shortest one is done
+		uint64_t steps = active[0]->job->size - active[0]->n;
+		for (l = 1; l < active_count; l++) {
+			if (active[l]->job->size - active[l]->n < steps)
+				steps = active[l]->job->size - active[l]->n;
+		}
+
+		// All lanes busy --> unrolled lockstep, the unroll below has to match RC4_BATCH_LANES
+		static_assert(RC4_BATCH_LANES == 4, "the unrolled lockstep loop steps exactly four lanes");
+		if (active_count == RC4_BATCH_LANES) {
+			rc4_lane* a = active[0];
+			rc4_lane* b = active[1];
+			rc4_lane* c = active[2];
+			rc4_lane* d = active[3];
+			for (uint64_t n = 0; n < steps; n++) {
+				lane_step(a);
+				lane_step(b);
+				lane_step(c);
+				lane_step(d);
+			}
+		}
+		else {
+			for (uint64_t n = 0; n < steps; n++) {
+				for (l = 0; l < active_count; l++)
+					lane_step(active[l]);
+			}
+		}
+
+		// Retire finished lanes and refill them with the next jobs
+		for (l = 0; l < active_count; ) {
+			rc4_lane* lane = active[l];
+			if (lane->n < lane->job->size) {
+				l++;
+			}
+			else if (!lane_load(lane, jobs, job_count, &next, &failed)) {
+				active[l] = active[--active_count];
+			}
+		}
+	}
+
+	RC4_TRACE2(batch_return, job_count, failed);
+	return failed;
+}
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Multi-stream batch engine
+
+Runs KSA for every job and then generates the keystream of RC4_BATCH_LANES
+independent streams in lockstep. A single RC4 stream is bound by the
+S[i] -> j -> S[j] load / store dependency chain, interleaving independent
+streams gives an out-of-order core several chains to work on per cycle.
+*/
+
+#ifndef __RC4_BATCH_H__
+#define __RC4_BATCH_H__
+
+#include <stdint.h>
+
+#define RC4_BATCH_LANES 4
+
+struct rc4_job {
+	uint8_t* key;
+	uint16_t key_size;
+	uint8_t* plaintext;     // NULL --> output the raw keystream
+	uint8_t* ciphertext;    // may be equal to plaintext (in place)
+	uint64_t size;
+	int status;             // set by rc4_batch(), 0 on success
+};
+
+// Returns the number of failed jobs (invalid key size)
+int rc4_batch(rc4_job* jobs, uint32_t job_count);
+
+#endif
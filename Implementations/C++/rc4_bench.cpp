@@ -0,0 +1,376 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Benchmark suite: message size x key length x buffer alignment sweeps
+
+Every configuration gets warmup runs followed by repeated samples. A sample
+repeats the call until at least BENCH_MIN_SAMPLE_BYTES have been processed,
+so small messages are not dominated by the timer resolution. The report
+contains the median and the median absolute deviation (MAD) in cycles per
+byte (x86 TSC ticks, calibrated against steady_clock; wall clock ns on other
+architectures) and MB/s (10^6 byte per second).
+
+Compile with this command:
+	g++ -O2 -o rc4_bench rc4_bench.cpp rc4_engine.cpp rc4_arena.cpp && ./rc4_bench
+*/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4.h"
+#include "rc4_timer.h"
+#include "rc4_arena.h"
+
+using namespace std;
+
+#define BENCH_MIN_SAMPLE_BYTES (1024 * 1024)
+#define BENCH_MAX_SIZE 0xffffffffULL // plaintext_size is a uint32_t --> 4 GiB - 1
+
+
+struct bench_case {
+	const char* engine;
+	uint64_t size;
+	uint32_t key_size;
+	uint32_t alignment;
+	uint8_t* key;
+	uint8_t* plaintext;
+	uint8_t* ciphertext;
+};
+
+struct bench_result {
+	bench_case config;
+	uint32_t samples;
+	uint64_t iterations;       // calls per sample
+	double median_cpb;
+	double mad_cpb;
+	double median_mbps;
+};
+
+typedef void (*bench_function)(bench_case* config);
+
+struct bench_engine {
+	const char* name;
+	bench_function run;
+};
+
+static void run_rc4(bench_case* config) {
+	rc4(config->key_size, config->size, config->key, config->plaintext, config->ciphertext);
+}
+
+static void run_keystream(bench_case* config) {
+	uint8_t array_s[N];
+	ksa(array_s, config->key, config->key_size);
+	prga_keystream(array_s, config->ciphertext, config->size);
+}
+
+static void run_rc4a(bench_case* config) {
+	uint8_t array_s1[N];
+	uint8_t array_s2[N];
+	rc4a_ksa(array_s1, array_s2, config->key, config->key_size);
+	rc4a_prga(array_s1, array_s2, config->plaintext, config->ciphertext, config->size);
+}
+
+static void run_crypt(bench_case* config) {
+	rc4_ctx ctx;
+	rc4_init(&ctx, config->key, config->key_size);
+	rc4_crypt(&ctx, config->plaintext, config->ciphertext, config->size);
+}
+
+static void run_cached(bench_case* config) {
+	rc4_ctx ctx;
+	rc4_init(&ctx, config->key, config->key_size);
+	rc4_crypt_cached(&ctx, config->plaintext, config->ciphertext, config->size);
+}
+
+static void run_stream(bench_case* config) {
+	rc4_ctx ctx;
+	rc4_init(&ctx, config->key, config->key_size);
+	rc4_crypt_stream(&ctx, config->plaintext, config->ciphertext, config->size);
+}
+
+template <typename T>
+static void run_width(bench_case* config) {
+	rc4_ctx ctx;
+	rc4_init(&ctx, config->key, config->key_size);
+	rc4_crypt_w<T>(&ctx, config->plaintext, config->ciphertext, config->size);
+}
+
+static void run_inplace(bench_case* config) {
+	rc4_ctx ctx;
+	rc4_init(&ctx, config->key, config->key_size);
+	encrypt_inplace(&ctx, config->ciphertext, config->size);
+}
+
+static const bench_engine engines[] = {
+	{ "rc4", run_rc4 },
+	{ "keystream", run_keystream },
+	{ "rc4a", run_rc4a },
+	{ "crypt", run_crypt },
+	{ "cached", run_cached },
+	{ "stream", run_stream },
+	{ "w8", run_width<uint8_t> },
+	{ "w16", run_width<uint16_t> },
+	{ "w32", run_width<uint32_t> },
+	{ "inplace", run_inplace },
+};
+
+static double ticks_per_ns = 1.0;
+
+static double median(vector<double> values) {
+	sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	if (values.size() % 2 == 0)
+		return (values[middle - 1] + values[middle]) / 2;
+	return values[middle];
+}
+
+static bench_result measure(bench_function run, bench_case* config, uint32_t warmup, uint32_t samples) {
+	bench_result result;
+	vector<double> cpb;
+	vector<double> mbps;
+
+	result.config = *config;
+	result.samples = samples;
+	result.iterations = (BENCH_MIN_SAMPLE_BYTES + config->size - 1) / config->size;
+
+	for (uint32_t w = 0; w < warmup; w++) {
+		for (uint64_t n = 0; n < result.iterations; n++)
+			run(config);
+	}
+
+	for (uint32_t s = 0; s < samples; s++) {
+		uint64_t begin = rc4_ticks();
+		for (uint64_t n = 0; n < result.iterations; n++)
+			run(config);
+		uint64_t end = rc4_ticks();
+
+		double bytes = (double) result.iterations * config->size;
+		double ticks = (double) (end - begin);
+		cpb.push_back(ticks / bytes);
+		mbps.push_back(bytes / (ticks / ticks_per_ns) * 1000.0);
+	}
+
+	result.median_cpb = median(cpb);
+	vector<double> deviation;
+	for (double value : cpb)
+		deviation.push_back(value > result.median_cpb ? value - result.median_cpb : result.median_cpb - value);
+	result.mad_cpb = median(deviation);
+	result.median_mbps = median(mbps);
+	return result;
+}
+
+static int parse_list(const char* text, vector<uint64_t>& out) {
+	out.clear();
+	while (*text) {
+		char* end = NULL;
+		uint64_t first = strtoull(text, &end, 0);
+		if (end == text)
+			return 1;
+		if (*end == '-') {
+			// Inclusive range
+			text = end + 1;
+			uint64_t last = strtoull(text, &end, 0);
+			if (end == text || last < first)
+				return 1;
+			for (uint64_t value = first; value <= last; value++)
+				out.push_back(value);
+		}
+		else {
+			out.push_back(first);
+		}
+		text = end;
+		if (*text == ',')
+			text++;
+		else if (*text != 0)
+			return 1;
+	}
+	return out.empty() ? 1 : 0;
+}
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  -e <list>    : engines (rc4,keystream,rc4a,crypt,cached,stream,w8,w16,w32,inplace, default rc4)\n");
+	printf("  -s <min>     : smallest message size in byte (default 16)\n");
+	printf("  -S <max>     : largest message size in byte (default 64 MiB, max 4 GiB - 1)\n");
+	printf("  -f <factor>  : size step factor (default 4)\n");
+	printf("  -k <list>    : key sizes, e.g. 1-32 or 5,16,32 (default 1,5,16,32)\n");
+	printf("  -a <list>    : buffer alignment offsets, e.g. 0,1,3 (default 0,1)\n");
+	printf("  -w <count>   : warmup runs (default 2)\n");
+	printf("  -r <count>   : samples per configuration (default 11)\n");
+	printf("  -j <file>    : write the results as JSON\n");
+	printf("  -h           : print this message\n");
+}
+
+static int write_json(const char* path, vector<bench_result>& results, uint32_t warmup) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		printf("[!] Could not open %s!\n", path);
+		return 1;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"cycle_source\": \"%s\",\n", RC4_TIMER_SOURCE);
+	fprintf(file, "  \"ticks_per_ns\": %.4f,\n", ticks_per_ns);
+	fprintf(file, "  \"warmup\": %u,\n", warmup);
+	fprintf(file, "  \"min_sample_bytes\": %d,\n", BENCH_MIN_SAMPLE_BYTES);
+	fprintf(file, "  \"results\": [\n");
+	for (size_t n = 0; n < results.size(); n++) {
+		bench_result& r = results[n];
+		fprintf(file, "    {\"engine\": \"%s\", \"size\": %llu, \"key_size\": %u, \"alignment\": %u, \"samples\": %u, \"iterations\": %llu, "
+			"\"median_cpb\": %.4f, \"mad_cpb\": %.4f, \"median_mbps\": %.2f}%s\n",
+			r.config.engine, (unsigned long long) r.config.size, r.config.key_size, r.config.alignment, r.samples,
+			(unsigned long long) r.iterations, r.median_cpb, r.mad_cpb, r.median_mbps, (n + 1 < results.size()) ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	fclose(file);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	uint64_t min_size = 16;
+	uint64_t max_size = 64 * 1024 * 1024;
+	uint64_t factor = 4;
+	uint32_t warmup = 2;
+	uint32_t samples = 11;
+	const char* json_path = NULL;
+	vector<uint64_t> key_sizes = { 1, 5, 16, 32 };
+	vector<uint64_t> alignments = { 0, 1 };
+	vector<const bench_engine*> selected;
+	string engine_list = "rc4";
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-e") == 0) && (i < (argc - 1))) { engine_list = argv[++i]; }
+		else if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { min_size = strtoull(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-S") == 0) && (i < (argc - 1))) { max_size = strtoull(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-f") == 0) && (i < (argc - 1))) { factor = strtoull(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { if (parse_list(argv[++i], key_sizes) != 0) { print_help(); return 1; } }
+		else if ((strcmp(argv[i], "-a") == 0) && (i < (argc - 1))) { if (parse_list(argv[++i], alignments) != 0) { print_help(); return 1; } }
+		else if ((strcmp(argv[i], "-w") == 0) && (i < (argc - 1))) { warmup = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-r") == 0) && (i < (argc - 1))) { samples = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-j") == 0) && (i < (argc - 1))) { json_path = argv[++i]; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	// Engine selection
+	size_t position = 0;
+	while (position <= engine_list.size()) {
+		size_t comma = engine_list.find(',', position);
+		string name = engine_list.substr(position, comma == string::npos ? string::npos : comma - position);
+		const bench_engine* found = NULL;
+		for (const bench_engine& engine : engines) {
+			if (name == engine.name)
+				found = &engine;
+		}
+		if (found == NULL) {
+			printf("[!] Unknown engine %s!\n", name.c_str());
+			return 1;
+		}
+		selected.push_back(found);
+		if (comma == string::npos)
+			break;
+		position = comma + 1;
+	}
+
+	// Input Validation
+	if (min_size == 0 || max_size < min_size || max_size > BENCH_MAX_SIZE || factor < 2 || samples == 0) {
+		print_help();
+		return 1;
+	}
+	for (uint64_t key_size : key_sizes) {
+		if (key_size == 0 || key_size > 32) {
+			printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+			return 1;
+		}
+	}
+	uint64_t max_alignment = *max_element(alignments.begin(), alignments.end());
+	if (max_alignment >= 4096) {
+		printf("[!] Alignment offsets have to be below 4096!\n");
+		return 1;
+	}
+
+	// Page aligned (huge pages from 2 MiB) buffers, the alignment offset gets added per configuration
+	size_t buffer_size = max_size + max_alignment;
+	rc4_buffer plaintext_buffer;
+	rc4_buffer ciphertext_buffer;
+	if (rc4_buffer_alloc(&plaintext_buffer, buffer_size) != 0 || rc4_buffer_alloc(&ciphertext_buffer, buffer_size) != 0)
+		return 1;
+	uint8_t* plaintext = plaintext_buffer.data;
+	uint8_t* ciphertext = ciphertext_buffer.data;
+	memset(plaintext, 'a', buffer_size);
+	memset(ciphertext, 0, buffer_size);
+
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[32] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+
+	ticks_per_ns = rc4_ticks_per_ns();
+	printf("[*] %.3f ticks/ns, %u warmup runs, %u samples, >= %d byte per sample\n", ticks_per_ns, warmup, samples, BENCH_MIN_SAMPLE_BYTES);
+	printf("[*] Buffers: %s\n", rc4_buffer_pages(&plaintext_buffer));
+	printf("[*] Calibrated S-box element width: %d byte\n", rc4_width());
+	printf("%-10s %12s %4s %5s %12s %10s %12s\n", "engine", "size", "key", "align", "cycles/byte", "MAD", "MB/s");
+
+	vector<bench_result> results;
+	for (const bench_engine* engine : selected) {
+		for (uint64_t size = min_size; size <= max_size; size *= factor) {
+			for (uint64_t key_size : key_sizes) {
+				for (uint64_t alignment : alignments) {
+					bench_case config;
+					config.engine = engine->name;
+					config.size = size;
+					config.key_size = key_size;
+					config.alignment = alignment;
+					config.key = key;
+					config.plaintext = plaintext + alignment;
+					config.ciphertext = ciphertext + alignment;
+
+					bench_result result = measure(engine->run, &config, warmup, samples);
+					results.push_back(result);
+					printf("%-10s %12llu %4u %5u %12.3f %10.3f %12.2f\n", engine->name, (unsigned long long) size, (unsigned) key_size,
+						(unsigned) alignment, result.median_cpb, result.mad_cpb, result.median_mbps);
+					fflush(stdout);
+				}
+			}
+			if (size > max_size / factor)
+				break;
+		}
+	}
+
+	rc4_buffer_free(&plaintext_buffer);
+	rc4_buffer_free(&ciphertext_buffer);
+
+	if (json_path != NULL)
+		return write_json(json_path, results, warmup);
+	return 0;
+}
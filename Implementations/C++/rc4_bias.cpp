@@ -0,0 +1,365 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Keystream bias analysis engine
+
+Generates the first K keystream bytes for a huge number of random keys and
+counts per-position byte frequencies (e.g. the second byte bias towards 0x00).
+	- no plaintext, only ksa() + prga_keystream()
+	- keys are derived from (seed, key index), so every run is reproducible
+	- every thread counts into its own cache resident uint32_t histogram,
+	  which gets merged into the global uint64_t histogram after each round
+	- after each round the global state is written to the checkpoint file,
+	  an interrupted run continues from the last completed round
+
+Compile with this command:
+	g++ -O2 -pthread -o rc4_bias rc4_bias.cpp rc4_engine.cpp && ./rc4_bias
+*/
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4.h"
+
+using namespace std;
+
+#define BIAS_MAX_POSITIONS 256
+#define BIAS_MAX_KEY_SIZE 32
+#define BIAS_ROUND_KEYS (1ULL << 24) // keys per checkpoint round (per thread counters stay below 2^32)
+#define BIAS_CHECKPOINT_MAGIC 0x42344352 // "RC4B"
+
+
+struct bias_run {
+	uint64_t seed;
+	uint64_t keys_total;
+	uint64_t keys_done;
+	uint32_t key_size;
+	uint32_t positions;
+	vector<uint64_t> counts;    // positions * 256
+};
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  (no arguments) : run the self test (second byte bias over 2^20 keys)\n");
+	printf("  -n <log2 keys> : number of random keys as power of two (default 30)\n");
+	printf("  -k <bytes>     : key size (default 16)\n");
+	printf("  -K <bytes>     : keystream positions to analyse (default 16)\n");
+	printf("  -t <threads>   : worker threads (default: all cores)\n");
+	printf("  -s <seed>      : key generator seed (default 1)\n");
+	printf("  -c <file>      : checkpoint file (resumed if it exists)\n");
+	printf("  -o <file>      : CSV output (position,byte,count)\n");
+	printf("  -h             : print this message\n");
+}
+
+// SplitMix64 --> cheap, stateless key derivation from the key index
+static inline uint64_t splitmix64(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+static inline void derive_key(uint64_t seed, uint64_t index, uint8_t* key, uint32_t key_size) {
+	uint64_t state = seed ^ (index * 0xd1b54a32d192ed03ULL);
+	for (uint32_t n = 0; n < key_size; n += 8) {
+		uint64_t word = splitmix64(state + n);
+		for (uint32_t b = 0; b < 8 && n + b < key_size; b++)
+			key[n + b] = (uint8_t) (word >> (8 * b));
+	}
+}
+
+// Counts the keystream bytes of the keys [first, last) into the thread local histogram
+static void bias_worker(bias_run* run, uint64_t first, uint64_t last, uint32_t* histogram) {
+	uint8_t array_s[N];
+	uint8_t key[BIAS_MAX_KEY_SIZE];
+	uint8_t keystream[BIAS_MAX_POSITIONS];
+	uint32_t positions = run->positions;
+
+	for (uint64_t index = first; index < last; index++) {
+		derive_key(run->seed, index, key, run->key_size);
+		ksa(array_s, key, run->key_size);
+		prga_keystream(array_s, keystream, positions);
+		for (uint32_t p = 0; p < positions; p++)
+			histogram[p * 256 + keystream[p]]++;
+	}
+}
+
+static int save_checkpoint(const char* path, bias_run* run) {
+	string temporary = string(path) + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (file == NULL) {
+		printf("[!] Could not write the checkpoint %s!\n", temporary.c_str());
+		return 1;
+	}
+	uint32_t magic = BIAS_CHECKPOINT_MAGIC;
+	size_t ok = fwrite(&magic, sizeof(magic), 1, file);
+	ok += fwrite(&run->seed, sizeof(run->seed), 1, file);
+	ok += fwrite(&run->keys_total, sizeof(run->keys_total), 1, file);
+	ok += fwrite(&run->keys_done, sizeof(run->keys_done), 1, file);
+	ok += fwrite(&run->key_size, sizeof(run->key_size), 1, file);
+	ok += fwrite(&run->positions, sizeof(run->positions), 1, file);
+	ok += fwrite(run->counts.data(), sizeof(uint64_t) * run->counts.size(), 1, file);
+	fclose(file);
+
+	// Atomic replace --> a crash never leaves a half written checkpoint
+	if (ok != 7 || rename(temporary.c_str(), path) != 0) {
+		printf("[!] Could not write the checkpoint %s!\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+// Returns 1 if a matching checkpoint was loaded
+static int load_checkpoint(const char* path, bias_run* run) {
+	bias_run saved;
+	uint32_t magic = 0;
+
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return 0;
+	size_t ok = fread(&magic, sizeof(magic), 1, file);
+	ok += fread(&saved.seed, sizeof(saved.seed), 1, file);
+	ok += fread(&saved.keys_total, sizeof(saved.keys_total), 1, file);
+	ok += fread(&saved.keys_done, sizeof(saved.keys_done), 1, file);
+	ok += fread(&saved.key_size, sizeof(saved.key_size), 1, file);
+	ok += fread(&saved.positions, sizeof(saved.positions), 1, file);
+	if (ok != 6 || magic != BIAS_CHECKPOINT_MAGIC || saved.seed != run->seed || saved.keys_total != run->keys_total ||
+		saved.key_size != run->key_size || saved.positions != run->positions || saved.keys_done > saved.keys_total) {
+		printf("[!] The checkpoint %s does not match the parameters, starting from scratch!\n", path);
+		fclose(file);
+		return 0;
+	}
+	ok = fread(run->counts.data(), sizeof(uint64_t) * run->counts.size(), 1, file);
+	fclose(file);
+	if (ok != 1) {
+		printf("[!] The checkpoint %s is truncated, starting from scratch!\n", path);
+		memset(run->counts.data(), 0, sizeof(uint64_t) * run->counts.size());
+		return 0;
+	}
+	run->keys_done = saved.keys_done;
+	return 1;
+}
+
+static int run_analysis(bias_run* run, unsigned threads, const char* checkpoint_path) {
+	vector<vector<uint32_t>> histograms(threads, vector<uint32_t>(run->positions * 256));
+
+	while (run->keys_done < run->keys_total) {
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		uint64_t round_keys = run->keys_total - run->keys_done;
+		if (round_keys > BIAS_ROUND_KEYS * threads)
+			round_keys = BIAS_ROUND_KEYS * threads;
+
+		// Partition the round over the threads
+		vector<std::thread> workers;
+		uint64_t per_thread = (round_keys + threads - 1) / threads;
+		for (unsigned t = 0; t < threads; t++) {
+			uint64_t first = run->keys_done + t * per_thread;
+			uint64_t last = first + per_thread;
+			if (last > run->keys_done + round_keys)
+				last = run->keys_done + round_keys;
+			if (first >= last)
+				break;
+			memset(histograms[t].data(), 0, histograms[t].size() * sizeof(uint32_t));
+			workers.push_back(std::thread(bias_worker, run, first, last, histograms[t].data()));
+		}
+		for (auto& w : workers)
+			w.join();
+
+		// Merge the thread local histograms
+		for (unsigned t = 0; t < workers.size(); t++) {
+			for (size_t n = 0; n < run->counts.size(); n++)
+				run->counts[n] += histograms[t][n];
+		}
+		run->keys_done += round_keys;
+
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1e6;
+		printf("[*] %llu / %llu keys (%.2f%%), %.0f keys/s\n", (unsigned long long) run->keys_done, (unsigned long long) run->keys_total,
+			100.0 * run->keys_done / run->keys_total, round_keys / seconds);
+		fflush(stdout);
+
+		if (checkpoint_path != NULL && save_checkpoint(checkpoint_path, run) != 0)
+			return 1;
+	}
+	return 0;
+}
+
+static void print_summary(bias_run* run) {
+	printf("[*] Position  most frequent byte  ratio to 1/256  least frequent byte  ratio to 1/256\n");
+	for (uint32_t p = 0; p < run->positions; p++) {
+		uint64_t* counts = &run->counts[p * 256];
+		uint32_t max_byte = 0;
+		uint32_t min_byte = 0;
+		for (uint32_t b = 1; b < 256; b++) {
+			if (counts[b] > counts[max_byte])
+				max_byte = b;
+			if (counts[b] < counts[min_byte])
+				min_byte = b;
+		}
+		double expected = run->keys_done / 256.0;
+		printf("[*] %8u  0x%02x                %14.4f  0x%02x                 %14.4f\n", p + 1,
+			max_byte, counts[max_byte] / expected, min_byte, counts[min_byte] / expected);
+	}
+}
+
+static int write_csv(const char* path, bias_run* run) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		printf("[!] Could not open %s!\n", path);
+		return 1;
+	}
+	fprintf(file, "position,byte,count\n");
+	for (uint32_t p = 0; p < run->positions; p++) {
+		for (uint32_t b = 0; b < 256; b++)
+			fprintf(file, "%u,%u,%llu\n", p + 1, b, (unsigned long long) run->counts[p * 256 + b]);
+	}
+	fclose(file);
+	return 0;
+}
+
+static int self_test(unsigned threads) {
+	int i = 0;
+	int error = 0;
+
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[32] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+	// 3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595
+	uint8_t plaintext[32] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2,
+			0xe0, 0xf8, 0x51, 0x2c, 0xb3, 0x5a, 0x75, 0x79,
+			0xfd, 0x79, 0x57, 0x5c, 0xf2, 0x87, 0xc5, 0x95
+	};
+	// 2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179
+	uint8_t known_ciphertext[32] = {
+			0x22, 0x80, 0xc9, 0x67, 0x6c, 0x8f, 0x5c, 0x52,
+			0xab, 0xa8, 0xd4, 0x26, 0x11, 0xf8, 0x5e, 0x7c,
+			0xa9, 0x61, 0xa2, 0x11, 0x7d, 0x3c, 0xfc, 0x82,
+			0x36, 0xa6, 0x05, 0x1b, 0xbf, 0xc5, 0xf1, 0x79
+	};
+
+	// prga_keystream() has to produce the same keystream as prga()
+	uint8_t array_s[N];
+	uint8_t keystream[32];
+	ksa(array_s, key, 32);
+	prga_keystream(array_s, keystream, 32);
+	for (i = 0; i < 32; i++) {
+		if ((keystream[i] ^ plaintext[i]) != known_ciphertext[i])
+			error += 1;
+	}
+
+	// Mantin-Shamir: the second keystream byte is 0x00 with probability ~2/256
+	bias_run run;
+	run.seed = 1;
+	run.keys_total = 1ULL << 20;
+	run.keys_done = 0;
+	run.key_size = 16;
+	run.positions = 4;
+	run.counts.assign(run.positions * 256, 0);
+	error += run_analysis(&run, threads, NULL);
+	print_summary(&run);
+
+	double ratio = run.counts[1 * 256 + 0] / (run.keys_done / 256.0);
+	printf("[*] Second byte 0x00 ratio: %.4f (expected ~2.0)\n", ratio);
+	if (ratio < 1.8 || ratio > 2.2)
+		error += 1;
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	return error;
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	unsigned threads = 0;
+	uint32_t log2_keys = 30;
+	const char* checkpoint_path = NULL;
+	const char* output_path = NULL;
+	bias_run run;
+
+	run.seed = 1;
+	run.key_size = 16;
+	run.positions = 16;
+	run.keys_done = 0;
+
+	threads = std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+
+	if (argc == 1)
+		return self_test(threads) == 0 ? 0 : 1;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-n") == 0) && (i < (argc - 1))) { log2_keys = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { run.key_size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-K") == 0) && (i < (argc - 1))) { run.positions = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-t") == 0) && (i < (argc - 1))) { threads = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { run.seed = strtoull(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-c") == 0) && (i < (argc - 1))) { checkpoint_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-o") == 0) && (i < (argc - 1))) { output_path = argv[++i]; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	// Input Validation
+	if (run.key_size == 0 || run.key_size > BIAS_MAX_KEY_SIZE || run.positions == 0 || run.positions > BIAS_MAX_POSITIONS ||
+		log2_keys > 48 || threads == 0) {
+		print_help();
+		return 1;
+	}
+	run.keys_total = 1ULL << log2_keys;
+	run.counts.assign(run.positions * 256, 0);
+
+	if (checkpoint_path != NULL && load_checkpoint(checkpoint_path, &run))
+		printf("[*] Resuming from %s at %llu keys\n", checkpoint_path, (unsigned long long) run.keys_done);
+
+	if (run_analysis(&run, threads, checkpoint_path) != 0)
+		return 1;
+	print_summary(&run);
+
+	if (output_path != NULL)
+		return write_csv(output_path, &run);
+	return 0;
+}
@@ -0,0 +1,241 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <stdio.h>
+#include <cstring>
+#include "rc4_container.h"
+#include "rc4.h"
+
+static const uint8_t rc4c_magic[4] = { 'R', 'C', '4', 'C' };
+
+static void store_le(uint8_t* p, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		p[i] = (uint8_t) (value >> (8 * i));
+}
+
+static uint64_t load_le(uint8_t* p, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++)
+		value |= ((uint64_t) p[i]) << (8 * i);
+	return value;
+}
+
+// Runs fn(chunk) for every chunk, distributed over the worker threads
+template <typename F>
+static int for_each_chunk(uint32_t chunk_count, unsigned threads, F fn) {
+	std::atomic<uint32_t> next(0);
+	std::atomic<int> error(0);
+	std::vector<std::thread> workers;
+
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+	if (threads > chunk_count)
+		threads = chunk_count;
+
+	auto worker = [&]() {
+		uint32_t chunk;
+		while ((chunk = next++) < chunk_count && error == 0) {
+			if (fn(chunk) != 0)
+				error = 1;
+		}
+	};
+
+	for (unsigned t = 1; t < threads; t++)
+		workers.push_back(std::thread(worker));
+	worker();
+	for (auto& w : workers)
+		w.join();
+
+	return error;
+}
+
+int rc4c_parse_header(uint8_t* data, uint64_t data_size, rc4c_header* header) {
+	if (data_size < RC4C_HEADER_SIZE || memcmp(data, rc4c_magic, 4) != 0) {
+		printf("[!] Not an RC4C container!\n");
+		return 1;
+	}
+
+	header->version = load_le(data + 4, 2);
+	header->iv_size = load_le(data + 6, 2);
+	header->chunk_size = load_le(data + 8, 4);
+	header->chunk_count = load_le(data + 12, 4);
+	header->plaintext_size = load_le(data + 16, 8);
+	header->index_offset = load_le(data + 24, 8);
+
+	if (header->version != RC4C_VERSION || header->iv_size != RC4C_IV_SIZE || header->chunk_size == 0) {
+		printf("[!] Unsupported RC4C container (version %d, IV size %d)!\n", header->version, header->iv_size);
+		return 1;
+	}
+	if (header->index_offset > data_size ||
+		(data_size - header->index_offset) / RC4C_INDEX_ENTRY_SIZE < header->chunk_count) {
+		printf("[!] The RC4C chunk index is truncated!\n");
+		return 1;
+	}
+	return 0;
+}
+
+int rc4c_read_chunk(uint8_t* data, uint64_t data_size, rc4c_header* header, uint32_t chunk, rc4c_chunk* entry) {
+	if (chunk >= header->chunk_count) {
+		printf("[!] Chunk %u is out of range (%u chunks)!\n", chunk, header->chunk_count);
+		return 1;
+	}
+
+	uint8_t* p = data + header->index_offset + (uint64_t) chunk * RC4C_INDEX_ENTRY_SIZE;
+	entry->offset = load_le(p, 8);
+	entry->size = load_le(p + 8, 4);
+	memcpy(entry->iv, p + 16, RC4C_IV_SIZE);
+
+	if (entry->size > header->chunk_size || entry->offset > data_size || data_size - entry->offset < entry->size) {
+		printf("[!] Chunk %u points outside of the container!\n", chunk);
+		return 1;
+	}
+	return 0;
+}
+
+int rc4c_crypt_chunk(uint8_t* key, uint16_t key_size, rc4c_chunk* entry, uint8_t* in, uint8_t* out) {
+	uint8_t array_s[N] = { 0 };
+	uint8_t chunk_key[RC4C_IV_SIZE + RC4C_MAX_KEY_SIZE];
+
+	// Input Validation
+	if (key_size == 0 || key_size > RC4C_MAX_KEY_SIZE) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+
+	// Chunk key --> IV || master key
+	memcpy(chunk_key, entry->iv, RC4C_IV_SIZE);
+	memcpy(chunk_key + RC4C_IV_SIZE, key, key_size);
+
+	ksa(array_s, chunk_key, RC4C_IV_SIZE + key_size);
+	prga(array_s, in, out, entry->size);
+	return 0;
+}
+
+int rc4c_encrypt(
+	uint8_t* key,
+	uint16_t key_size,
+	uint8_t* plaintext,
+	uint64_t plaintext_size,
+	uint32_t chunk_size,
+	unsigned threads,
+	std::vector<uint8_t>& container_out) {
+
+	if (chunk_size == 0)
+		chunk_size = RC4C_DEFAULT_CHUNK_SIZE;
+
+	uint64_t chunk_count = (plaintext_size + chunk_size - 1) / chunk_size;
+	if (chunk_count > UINT32_MAX) {
+		printf("[!] Too many chunks, increase the chunk size!\n");
+		return 1;
+	}
+
+	uint64_t index_offset = RC4C_HEADER_SIZE;
+	uint64_t data_offset = index_offset + chunk_count * RC4C_INDEX_ENTRY_SIZE;
+	container_out.assign(data_offset + plaintext_size, 0);
+	uint8_t* out = container_out.data();
+
+	// Header
+	memcpy(out, rc4c_magic, 4);
+	store_le(out + 4, RC4C_VERSION, 2);
+	store_le(out + 6, RC4C_IV_SIZE, 2);
+	store_le(out + 8, chunk_size, 4);
+	store_le(out + 12, chunk_count, 4);
+	store_le(out + 16, plaintext_size, 8);
+	store_le(out + 24, index_offset, 8);
+
+	// Index --> fresh random IV for every chunk
+	std::random_device random;
+	for (uint64_t chunk = 0; chunk < chunk_count; chunk++) {
+		uint8_t* p = out + index_offset + chunk * RC4C_INDEX_ENTRY_SIZE;
+		uint64_t offset = chunk * chunk_size;
+		uint64_t size = (plaintext_size - offset < chunk_size) ? plaintext_size - offset : chunk_size;
+
+		store_le(p, data_offset + offset, 8);
+		store_le(p + 8, size, 4);
+		for (int i = 0; i < RC4C_IV_SIZE; i += 4)
+			store_le(p + 16 + i, random(), 4);
+	}
+
+	// Data
+	rc4c_header header;
+	uint64_t container_size = container_out.size();
+	if (rc4c_parse_header(out, container_size, &header) != 0)
+		return 1;
+
+	return for_each_chunk(chunk_count, threads, [&](uint32_t chunk) {
+		rc4c_chunk entry;
+
+		if (rc4c_read_chunk(out, container_size, &header, chunk, &entry) != 0)
+			return 1;
+		return rc4c_crypt_chunk(key, key_size, &entry, plaintext + (uint64_t) chunk * chunk_size, out + entry.offset);
+	});
+}
+
+int rc4c_decrypt(
+	uint8_t* key,
+	uint16_t key_size,
+	uint8_t* container,
+	uint64_t container_size,
+	unsigned threads,
+	std::vector<uint8_t>& plaintext_out) {
+
+	rc4c_header header;
+
+	if (rc4c_parse_header(container, container_size, &header) != 0)
+		return 1;
+	if ((uint64_t) header.chunk_count != (header.plaintext_size + header.chunk_size - 1) / header.chunk_size) {
+		printf("[!] The RC4C chunk index does not cover the plaintext size!\n");
+		return 1;
+	}
+
+	plaintext_out.assign(header.plaintext_size, 0);
+	uint8_t* out = plaintext_out.data();
+	std::atomic<uint64_t> decrypted(0);
+
+	int error = for_each_chunk(header.chunk_count, threads, [&](uint32_t chunk) {
+		rc4c_chunk entry;
+		uint64_t offset = (uint64_t) chunk * header.chunk_size;
+		uint64_t expected = (header.plaintext_size - offset < header.chunk_size) ? header.plaintext_size - offset : header.chunk_size;
+
+		if (rc4c_read_chunk(container, container_size, &header, chunk, &entry) != 0)
+			return 1;
+		// Every chunk but the last one is full, a short one would leave a hole in the plaintext
+		if (entry.size != expected) {
+			printf("[!] Chunk %u holds %u byte instead of %llu!\n", chunk, entry.size, (unsigned long long) expected);
+			return 1;
+		}
+		decrypted += entry.size;
+		return rc4c_crypt_chunk(key, key_size, &entry, container + entry.offset, out + offset);
+	});
+	if (error == 0 && decrypted != header.plaintext_size) {
+		printf("[!] The RC4C chunks hold %llu byte instead of %llu!\n", (unsigned long long) decrypted.load(), (unsigned long long) header.plaintext_size);
+		return 1;
+	}
+	return error;
+}
@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Chunked RC4 container (RC4C)
+
+The plaintext is split into fixed-size chunks. Every chunk is encrypted with
+its own RC4 stream keyed with IV || master key (WEP-style), where the IV is a
+random per-chunk value stored in the chunk index. Chunks are independent, so
+they can be encrypted / decrypted on all cores and a random read only needs
+to run KSA + PRGA over a single chunk.
+
+File layout (all integers little endian):
+	header   RC4C_HEADER_SIZE byte
+		magic          "RC4C"
+		version        uint16
+		iv_size        uint16
+		chunk_size     uint32
+		chunk_count    uint32
+		plaintext_size uint64
+		index_offset   uint64
+	index    chunk_count * RC4C_INDEX_ENTRY_SIZE byte
+		offset         uint64 (absolute file offset of the chunk data)
+		size           uint32 (plaintext / ciphertext size of the chunk)
+		reserved       uint32
+		iv             RC4C_IV_SIZE byte
+	data     ciphertext of all chunks
+*/
+
+#ifndef __RC4_CONTAINER_H__
+#define __RC4_CONTAINER_H__
+
+#include <stdint.h>
+#include <vector>
+
+#define RC4C_VERSION 1
+#define RC4C_IV_SIZE 16
+#define RC4C_MAX_KEY_SIZE 32
+#define RC4C_HEADER_SIZE 32
+#define RC4C_INDEX_ENTRY_SIZE (16 + RC4C_IV_SIZE)
+#define RC4C_DEFAULT_CHUNK_SIZE (1024 * 1024) // 1 MiB
+
+struct rc4c_header {
+	uint16_t version;
+	uint16_t iv_size;
+	uint32_t chunk_size;
+	uint32_t chunk_count;
+	uint64_t plaintext_size;
+	uint64_t index_offset;
+};
+
+struct rc4c_chunk {
+	uint64_t offset;
+	uint32_t size;
+	uint8_t iv[RC4C_IV_SIZE];
+};
+
+// Container parsing (returns 0 on success)
+int rc4c_parse_header(uint8_t* data, uint64_t data_size, rc4c_header* header);
+int rc4c_read_chunk(uint8_t* data, uint64_t data_size, rc4c_header* header, uint32_t chunk, rc4c_chunk* entry);
+
+// Encrypts / decrypts a single chunk (in and out may point to the same buffer)
+int rc4c_crypt_chunk(uint8_t* key, uint16_t key_size, rc4c_chunk* entry, uint8_t* in, uint8_t* out);
+
+// Whole container encryption / decryption (threads == 0 --> use all cores)
+int rc4c_encrypt(
+	uint8_t* key,
+	uint16_t key_size,
+	uint8_t* plaintext,
+	uint64_t plaintext_size,
+	uint32_t chunk_size,
+	unsigned threads,
+	std::vector<uint8_t>& container_out
+);
+
+int rc4c_decrypt(
+	uint8_t* key,
+	uint16_t key_size,
+	uint8_t* container,
+	uint64_t container_size,
+	unsigned threads,
+	std::vector<uint8_t>& plaintext_out
+);
+
+#endif
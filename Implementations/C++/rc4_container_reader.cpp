@@ -0,0 +1,190 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstring>
+#include "rc4_container_reader.h"
+
+int rc4c_reader_open(rc4c_reader* reader, const char* path, uint8_t* key, uint16_t key_size, unsigned cache_chunks) {
+	struct stat info;
+
+	reader->data = NULL;
+	reader->data_size = 0;
+	reader->cache_clock = 0;
+	reader->cache_hits = 0;
+	reader->cache_misses = 0;
+	reader->cache.clear();
+
+	// Input Validation
+	if (key_size == 0 || key_size > RC4C_MAX_KEY_SIZE) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+	memcpy(reader->key, key, key_size);
+	reader->key_size = key_size;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		printf("[!] Could not open %s!\n", path);
+		return 1;
+	}
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		printf("[!] Could not stat %s (or the file is empty)!\n", path);
+		close(fd);
+		return 1;
+	}
+
+	void* map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		printf("[!] Could not mmap %s!\n", path);
+		return 1;
+	}
+	reader->data = (uint8_t*) map;
+	reader->data_size = info.st_size;
+
+	if (rc4c_parse_header(reader->data, reader->data_size, &reader->header) != 0) {
+		rc4c_reader_close(reader);
+		return 1;
+	}
+
+	// Reads are mostly random, the kernel should not read ahead whole chunks
+	madvise(reader->data, reader->data_size, MADV_RANDOM);
+
+	reader->cache.resize(cache_chunks);
+	for (auto& slot : reader->cache) {
+		slot.chunk = -1;
+		slot.last_used = 0;
+	}
+	return 0;
+}
+
+void rc4c_reader_close(rc4c_reader* reader) {
+	if (reader->data != NULL)
+		munmap(reader->data, reader->data_size);
+	reader->data = NULL;
+	reader->data_size = 0;
+	reader->cache.clear();
+	memset(reader->key, 0, sizeof(reader->key));
+}
+
+// Copies [start, start + size) of a chunk out of the cache, decrypts the chunk into the cache on a miss
+static int read_cached(rc4c_reader* reader, rc4c_chunk* entry, uint32_t chunk, uint32_t start, uint32_t size, uint8_t* buffer) {
+	std::lock_guard<std::mutex> guard(reader->cache_lock);
+	rc4c_cache_slot* victim = &reader->cache[0];
+
+	reader->cache_clock++;
+	for (auto& slot : reader->cache) {
+		if (slot.chunk == chunk) {
+			slot.last_used = reader->cache_clock;
+			reader->cache_hits++;
+			memcpy(buffer, slot.plaintext.data() + start, size);
+			return 0;
+		}
+		if (slot.last_used < victim->last_used)
+			victim = &slot;
+	}
+
+	reader->cache_misses++;
+	victim->chunk = -1;
+	victim->plaintext.resize(entry->size);
+	if (rc4c_crypt_chunk(reader->key, reader->key_size, entry, reader->data + entry->offset, victim->plaintext.data()) != 0)
+		return 1;
+	victim->chunk = chunk;
+	victim->last_used = reader->cache_clock;
+	memcpy(buffer, victim->plaintext.data() + start, size);
+	return 0;
+}
+
+static int lookup_cached(rc4c_reader* reader, uint32_t chunk, uint32_t start, uint32_t size, uint8_t* buffer) {
+	std::lock_guard<std::mutex> guard(reader->cache_lock);
+
+	for (auto& slot : reader->cache) {
+		if (slot.chunk == chunk) {
+			slot.last_used = ++reader->cache_clock;
+			reader->cache_hits++;
+			memcpy(buffer, slot.plaintext.data() + start, size);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int64_t rc4c_reader_read(rc4c_reader* reader, uint64_t offset, uint8_t* buffer, uint64_t size) {
+	rc4c_header* header = &reader->header;
+	rc4c_chunk entry;
+	uint64_t done = 0;
+
+	if (reader->data == NULL)
+		return -1;
+	if (offset >= header->plaintext_size)
+		return 0;
+	if (size > header->plaintext_size - offset)
+		size = header->plaintext_size - offset;
+
+	while (done < size) {
+		uint64_t position = offset + done;
+		uint32_t chunk = position / header->chunk_size;
+		uint32_t start = position % header->chunk_size;
+
+		if (rc4c_read_chunk(reader->data, reader->data_size, header, chunk, &entry) != 0)
+			return -1;
+		if (start >= entry.size) {
+			printf("[!] Chunk %u is shorter than the chunk size!\n", chunk);
+			return -1;
+		}
+
+		uint32_t length = entry.size - start;
+		if (length > size - done)
+			length = size - done;
+
+		if (lookup_cached(reader, chunk, start, length, buffer + done)) {
+			// Hot chunk
+		}
+		else if (start == 0) {
+			// Keystream starts at the chunk boundary --> decrypt straight into the caller's buffer
+			entry.size = length;
+			if (rc4c_crypt_chunk(reader->key, reader->key_size, &entry, reader->data + entry.offset, buffer + done) != 0)
+				return -1;
+		}
+		else if (reader->cache.size() > 0) {
+			if (read_cached(reader, &entry, chunk, start, length, buffer + done) != 0)
+				return -1;
+		}
+		else {
+			// No cache --> decrypt the chunk prefix into a scratch buffer
+			std::vector<uint8_t> scratch(start + length);
+			entry.size = start + length;
+			if (rc4c_crypt_chunk(reader->key, reader->key_size, &entry, reader->data + entry.offset, scratch.data()) != 0)
+				return -1;
+			memcpy(buffer + done, scratch.data() + start, length);
+		}
+		done += length;
+	}
+	return done;
+}
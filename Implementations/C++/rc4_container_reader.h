@@ -0,0 +1,74 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Random access reader for RC4C containers (see rc4_container.h)
+
+The container gets memory mapped and a read only decrypts the chunks that
+cover the requested byte range:
+	- fully covered chunks are decrypted directly into the caller's buffer
+	- a range that starts at a chunk boundary decrypts only the bytes it needs
+	- a range that starts inside a chunk needs the keystream from the chunk
+	  start, so the whole chunk gets decrypted into the hot chunk cache
+Cached chunks are served with a plain memcpy (least recently used eviction).
+*/
+
+#ifndef __RC4_CONTAINER_READER_H__
+#define __RC4_CONTAINER_READER_H__
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include "rc4_container.h"
+
+#define RC4C_READER_DEFAULT_CACHE_CHUNKS 8
+
+struct rc4c_cache_slot {
+	int64_t chunk;      // -1 --> empty
+	uint64_t last_used;
+	std::vector<uint8_t> plaintext;
+};
+
+struct rc4c_reader {
+	uint8_t* data;
+	uint64_t data_size;
+	rc4c_header header;
+	uint8_t key[RC4C_MAX_KEY_SIZE];
+	uint16_t key_size;
+
+	std::mutex cache_lock;
+	uint64_t cache_clock;
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+	std::vector<rc4c_cache_slot> cache;
+};
+
+// Returns 0 on success
+int rc4c_reader_open(rc4c_reader* reader, const char* path, uint8_t* key, uint16_t key_size, unsigned cache_chunks);
+void rc4c_reader_close(rc4c_reader* reader);
+
+// Decrypts [offset, offset + size) into buffer, returns the number of bytes read or -1 on error
+int64_t rc4c_reader_read(rc4c_reader* reader, uint64_t offset, uint8_t* buffer, uint64_t size);
+
+#endif
@@ -0,0 +1,294 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Compile with this command:
+	g++ -O2 -pthread -o rc4_container rc4_container_tool.cpp rc4_container.cpp rc4_container_reader.cpp rc4_engine.cpp && ./rc4_container
+*/
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "rc4_container.h"
+#include "rc4_container_reader.h"
+#include "rc4.h"
+
+using namespace std;
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  (no arguments) : run the self test and speed test\n");
+	printf("  -e             : encrypt the input file into an RC4C container\n");
+	printf("  -d             : decrypt an RC4C container\n");
+	printf("  -r             : decrypt only a byte range of an RC4C container (see -s / -n)\n");
+	printf("  -k <hex>       : master key (1 - 32 byte, hex encoded)\n");
+	printf("  -i <file>      : input file\n");
+	printf("  -o <file>      : output file\n");
+	printf("  -c <bytes>     : chunk size (default %d)\n", RC4C_DEFAULT_CHUNK_SIZE);
+	printf("  -t <threads>   : worker threads (default: all cores)\n");
+	printf("  -s <offset>    : range read offset\n");
+	printf("  -n <bytes>     : range read size\n");
+	printf("  -h             : print this message\n");
+}
+
+int parse_hex(const char* hex, vector<uint8_t>& out) {
+	size_t len = strlen(hex);
+	if (len % 2 != 0)
+		return 1;
+	out.clear();
+	for (size_t i = 0; i < len; i += 2) {
+		char byte[3] = { hex[i], hex[i + 1], 0 };
+		char* end = NULL;
+		out.push_back((uint8_t) strtoul(byte, &end, 16));
+		if (*end != 0)
+			return 1;
+	}
+	return 0;
+}
+
+int read_file(const char* path, vector<uint8_t>& out) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		printf("[!] Could not open %s!\n", path);
+		return 1;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	out.resize(size);
+	size_t read = fread(out.data(), 1, size, file);
+	fclose(file);
+	if (read != (size_t) size) {
+		printf("[!] Could not read %s!\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+int write_file(const char* path, vector<uint8_t>& data) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		printf("[!] Could not open %s!\n", path);
+		return 1;
+	}
+	size_t written = fwrite(data.data(), 1, data.size(), file);
+	fclose(file);
+	if (written != data.size()) {
+		printf("[!] Could not write %s!\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+int self_test() {
+	int i = 0;
+	int error = 0;
+
+	// ae6c3c41884d35df3ab5adf30f5b2d36
+	uint8_t key[16] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36
+	};
+
+	// 3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595
+	uint8_t plaintext[32] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2,
+			0xe0, 0xf8, 0x51, 0x2c, 0xb3, 0x5a, 0x75, 0x79,
+			0xfd, 0x79, 0x57, 0x5c, 0xf2, 0x87, 0xc5, 0x95
+	};
+
+	// A chunk with an all zero IV has to match plain RC4 keyed with 0x00 * 16 || key
+	uint8_t iv_key[RC4C_IV_SIZE + 16] = { 0 };
+	memcpy(iv_key + RC4C_IV_SIZE, key, 16);
+	uint8_t expected[32] = { 0 };
+	uint8_t ciphertext[32] = { 0 };
+	rc4(RC4C_IV_SIZE + 16, 32, iv_key, plaintext, expected);
+
+	rc4c_chunk entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.size = 32;
+	rc4c_crypt_chunk(key, 16, &entry, plaintext, ciphertext);
+
+	printf("[*] Chunk (IV 0): 0x");
+	for (i = 0; i < 32; i++) {
+		printf("%02x", static_cast<int>(ciphertext[i]));
+		if (ciphertext[i] != expected[i])
+			error += 1;
+	}
+	printf("\n");
+	printf("[*] IV || KEY:    0x");
+	for (i = 0; i < 32; i++) {
+		printf("%02x", static_cast<int>(expected[i]));
+	}
+	printf("\n");
+
+	// Round trip with an odd sized last chunk
+	const uint64_t plaintext_size_test = 1024 * 1000 * 10 + 123; // ~10 Megabyte
+	vector<uint8_t> plaintext_test(plaintext_size_test);
+	for (uint64_t n = 0; n < plaintext_size_test; n++)
+		plaintext_test[n] = (uint8_t) (n * 31 + 7);
+	vector<uint8_t> container;
+	vector<uint8_t> decrypted;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	error += rc4c_encrypt(key, 16, plaintext_test.data(), plaintext_size_test, 64 * 1024, 0, container);
+	std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+	error += rc4c_decrypt(key, 16, container.data(), container.size(), 0, decrypted);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	if (decrypted != plaintext_test)
+		error += 1;
+	if (memcmp(container.data() + container.size() - plaintext_size_test, plaintext_test.data(), plaintext_size_test) == 0)
+		error += 1;
+
+	// Random range reads through the mmap reader
+	char path[] = "/tmp/rc4c_self_test_XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0 || write_file(path, container) != 0) {
+		error += 1;
+	}
+	else {
+		rc4c_reader reader;
+		vector<uint8_t> range(3 * 64 * 1024);
+		if (rc4c_reader_open(&reader, path, key, 16, RC4C_READER_DEFAULT_CACHE_CHUNKS) != 0) {
+			error += 1;
+		}
+		else {
+			std::chrono::steady_clock::time_point range_begin = std::chrono::steady_clock::now();
+			for (i = 0; i < 1000; i++) {
+				uint64_t offset = ((uint64_t) (i % 5) * 7919 * 1021 + (i % 2) * 64 * 1024 * 100) % plaintext_size_test;
+				uint64_t size = (i * 613) % range.size();
+				int64_t read = rc4c_reader_read(&reader, offset, range.data(), size);
+				uint64_t expected_size = (size < plaintext_size_test - offset) ? size : plaintext_size_test - offset;
+				if (read != (int64_t) expected_size || memcmp(range.data(), plaintext_test.data() + offset, expected_size) != 0)
+					error += 1;
+			}
+			std::chrono::steady_clock::time_point range_end = std::chrono::steady_clock::now();
+			printf("[*] 1000 range reads in %.2f ms (%lu cache hits, %lu misses)\n",
+				std::chrono::duration_cast<std::chrono::microseconds>(range_end - range_begin).count() / 1000.0,
+				(unsigned long) reader.cache_hits, (unsigned long) reader.cache_misses);
+			rc4c_reader_close(&reader);
+		}
+	}
+	if (fd >= 0) {
+		close(fd);
+		unlink(path);
+	}
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+
+	float enc_ms = std::chrono::duration_cast<std::chrono::microseconds>(middle - begin).count() / 1000.0;
+	float dec_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count() / 1000.0;
+	printf("[*] %u threads, %lu byte chunks\n", std::thread::hardware_concurrency(), (unsigned long) (64 * 1024));
+	printf("[*] Encrypted %d MB in %.2f seconds (%.2f MB/s)\n", (int) (plaintext_size_test / (1024 * 1000)), enc_ms / 1000, (plaintext_size_test / (1024.0 * 1000)) / (enc_ms / 1000));
+	printf("[*] Decrypted %d MB in %.2f seconds (%.2f MB/s)\n", (int) (plaintext_size_test / (1024 * 1000)), dec_ms / 1000, (plaintext_size_test / (1024.0 * 1000)) / (dec_ms / 1000));
+
+	return error;
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	int mode = 0;
+	const char* key_hex = NULL;
+	const char* input_path = NULL;
+	const char* output_path = NULL;
+	uint32_t chunk_size = RC4C_DEFAULT_CHUNK_SIZE;
+	unsigned threads = 0;
+	uint64_t range_offset = 0;
+	uint64_t range_size = 0;
+
+	if (argc == 1)
+		return self_test() == 0 ? 0 : 1;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-e") == 0) { mode = 'e'; }
+		else if (strcmp(argv[i], "-d") == 0) { mode = 'd'; }
+		else if (strcmp(argv[i], "-r") == 0) { mode = 'r'; }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_hex = argv[++i]; }
+		else if ((strcmp(argv[i], "-i") == 0) && (i < (argc - 1))) { input_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-o") == 0) && (i < (argc - 1))) { output_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-c") == 0) && (i < (argc - 1))) { chunk_size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-t") == 0) && (i < (argc - 1))) { threads = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { range_offset = strtoull(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-n") == 0) && (i < (argc - 1))) { range_size = strtoull(argv[++i], NULL, 0); }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	vector<uint8_t> key;
+	if (mode == 0 || key_hex == NULL || input_path == NULL || output_path == NULL) {
+		print_help();
+		return 1;
+	}
+	if (parse_hex(key_hex, key) != 0 || key.size() == 0 || key.size() > RC4C_MAX_KEY_SIZE) {
+		printf("[!] The key has to be 1 - 32 byte of hex!\n");
+		return 1;
+	}
+
+	vector<uint8_t> input;
+	vector<uint8_t> output;
+
+	if (mode == 'r') {
+		rc4c_reader reader;
+		if (rc4c_reader_open(&reader, input_path, key.data(), key.size(), RC4C_READER_DEFAULT_CACHE_CHUNKS) != 0)
+			return 1;
+		output.resize(range_size);
+		int64_t read = rc4c_reader_read(&reader, range_offset, output.data(), range_size);
+		rc4c_reader_close(&reader);
+		if (read < 0)
+			return 1;
+		output.resize(read);
+		return write_file(output_path, output);
+	}
+
+	if (read_file(input_path, input) != 0)
+		return 1;
+
+	int error = 0;
+	if (mode == 'e')
+		error = rc4c_encrypt(key.data(), key.size(), input.data(), input.size(), chunk_size, threads, output);
+	else
+		error = rc4c_decrypt(key.data(), key.size(), input.data(), input.size(), threads, output);
+	if (error != 0)
+		return 1;
+
+	return write_file(output_path, output);
+}
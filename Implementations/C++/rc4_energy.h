@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __RC4_ENERGY_H__
+#define __RC4_ENERGY_H__
+
+/*
+Energy counters from the Linux powercap interface (Intel RAPL, AMD RAPL)
+
+Header only, so the OpenCL speed test can include it as well. Every top
+level zone (package-0, package-1, ...) and its dram sub zone is read before
+and after the run, wraparounds are corrected with max_energy_range_uj. The
+counters cover the whole package, run on an otherwise idle host. Since
+Linux 5.10 energy_uj is only readable by root by default.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <cstring>
+#include <dirent.h>
+
+#ifndef RC4_ENERGY_POWERCAP
+#define RC4_ENERGY_POWERCAP "/sys/class/powercap"
+#endif
+#define RC4_ENERGY_MAX_ZONES 16
+
+
+struct rc4_energy {
+	int zones;
+	char path[RC4_ENERGY_MAX_ZONES][256];   // .../energy_uj
+	char name[RC4_ENERGY_MAX_ZONES][32];
+	uint64_t max_range[RC4_ENERGY_MAX_ZONES];
+	uint64_t start[RC4_ENERGY_MAX_ZONES];
+	double joules[RC4_ENERGY_MAX_ZONES];
+};
+
+static inline int rc4_energy_read(const char* path, uint64_t* value) {
+	unsigned long long parsed = 0;
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+		return 1;
+	int matched = fscanf(file, "%llu", &parsed);
+	fclose(file);
+	*value = parsed;
+	return (matched == 1) ? 0 : 1;
+}
+
+static inline void rc4_energy_add_zone(rc4_energy* energy, const char* zone) {
+	char path[256];
+	uint64_t value = 0;
+	if (energy->zones == RC4_ENERGY_MAX_ZONES)
+		return;
+
+	int index = energy->zones;
+	snprintf(energy->path[index], sizeof(energy->path[index]), "%s/%s/energy_uj", RC4_ENERGY_POWERCAP, zone);
+	if (rc4_energy_read(energy->path[index], &value) != 0)
+		return;
+	snprintf(path, sizeof(path), "%s/%s/max_energy_range_uj", RC4_ENERGY_POWERCAP, zone);
+	if (rc4_energy_read(path, &energy->max_range[index]) != 0)
+		energy->max_range[index] = 0;
+
+	snprintf(path, sizeof(path), "%s/%s/name", RC4_ENERGY_POWERCAP, zone);
+	FILE* file = fopen(path, "r");
+	if (file == NULL || fgets(energy->name[index], sizeof(energy->name[index]), file) == NULL)
+		snprintf(energy->name[index], sizeof(energy->name[index]), "%s", zone);
+	if (file != NULL)
+		fclose(file);
+	energy->name[index][strcspn(energy->name[index], "\n")] = 0;
+	energy->zones += 1;
+}
+
+// Returns 0 if at least one zone is readable
+static inline int rc4_energy_open(rc4_energy* energy) {
+	memset(energy, 0, sizeof(rc4_energy));
+	DIR* directory = opendir(RC4_ENERGY_POWERCAP);
+	if (directory == NULL)
+		return 1;
+
+	struct dirent* entry;
+	while ((entry = readdir(directory)) != NULL) {
+		int package = 0;
+		int sub = 0;
+		char tail = 0;
+		// intel-rapl:0 (package) and intel-rapl:0:N (core, uncore, dram), only keep package and dram
+		if (sscanf(entry->d_name, "intel-rapl:%d%c", &package, &tail) == 1) {
+			rc4_energy_add_zone(energy, entry->d_name);
+		}
+		else if (sscanf(entry->d_name, "intel-rapl:%d:%d", &package, &sub) == 2) {
+			char path[512];
+			char name[32] = { 0 };
+			snprintf(path, sizeof(path), "%s/%s/name", RC4_ENERGY_POWERCAP, entry->d_name);
+			FILE* file = fopen(path, "r");
+			if (file != NULL) {
+				if (fgets(name, sizeof(name), file) != NULL && strncmp(name, "dram", 4) == 0)
+					rc4_energy_add_zone(energy, entry->d_name);
+				fclose(file);
+			}
+		}
+	}
+	closedir(directory);
+	return (energy->zones > 0) ? 0 : 1;
+}
+
+static inline void rc4_energy_start(rc4_energy* energy) {
+	for (int z = 0; z < energy->zones; z++) {
+		if (rc4_energy_read(energy->path[z], &energy->start[z]) != 0)
+			energy->start[z] = 0;
+	}
+}
+
+static inline void rc4_energy_stop(rc4_energy* energy) {
+	for (int z = 0; z < energy->zones; z++) {
+		uint64_t end = 0;
+		if (rc4_energy_read(energy->path[z], &end) != 0) {
+			energy->joules[z] = 0;
+			continue;
+		}
+		uint64_t delta = (end >= energy->start[z]) ? end - energy->start[z] : energy->max_range[z] - energy->start[z] + end;
+		energy->joules[z] = delta / 1e6;
+	}
+}
+
+// Joules per GB (10^9 byte) for every zone
+static inline void rc4_energy_print(rc4_energy* energy, uint64_t bytes) {
+	if (energy->zones == 0) {
+		printf("[*] Energy: n/a (no readable powercap zones in %s)\n", RC4_ENERGY_POWERCAP);
+		return;
+	}
+	for (int z = 0; z < energy->zones; z++) {
+		printf("[*] Energy %-10s: %.3f J (%.2f J/GB)\n", energy->name[z], energy->joules[z],
+			bytes ? energy->joules[z] / (bytes / 1e9) : 0.0);
+	}
+}
+
+#endif
@@ -0,0 +1,364 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <cstring>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "rc4.h"
+#include "rc4_trace.h"
+
+void rc4(
+	uint16_t key_size_in,
+	uint32_t plaintext_size_in,
+	uint8_t* key_in,
+	uint8_t* plaintext_in,
+	uint8_t* ciphertext_out) {
+
+	// Variable Declaration
+	uint8_t array_s[N] = { 0 };
+	int i = 0;
+
+	// Input Validation
+	if (key_size_in == 0 || key_size_in > 32) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!");
+		return;
+	}
+
+	RC4_TRACE2(rc4_entry, key_size_in, plaintext_size_in);
+
+	// KSA - Key Scheduling Algorithm
+	ksa(array_s, key_in, key_size_in);
+
+	// PRGA - Pseudo Random Generation Algorithm
+	prga(array_s, plaintext_in, ciphertext_out, plaintext_size_in);
+
+	RC4_TRACE1(rc4_return, plaintext_size_in);
+}
+
+void swap(uint8_t* a, uint8_t* b) {
+	uint8_t tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+int ksa(uint8_t* array_s, uint8_t* key, uint16_t key_size) {
+	RC4_TRACE1(ksa_entry, key_size);
+	int result = ksa_n<N>(array_s, key, key_size);
+	RC4_TRACE1(ksa_return, result);
+	return result;
+}
+
+void ksa_prefix_init(ksa_prefix_state* state, uint16_t key_size) {
+	state->key_size = key_size;
+	state->valid = 0;
+	state->j[0] = 0;
+	for (uint32_t i = 0; i < N; i++)
+		state->levels[0][i] = i;
+}
+
+int ksa_prefix(ksa_prefix_state* state, uint8_t* array_s, uint8_t* key) {
+	uint32_t key_size = state->key_size;
+	uint32_t depth = 0;
+	uint32_t j = 0;
+	uint32_t i = 0;
+
+	// Input Validation
+	if (key_size == 0 || key_size > KSA_MAX_KEY_SIZE) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+
+	// Deepest snapshot that is still valid for this key
+	while (depth < state->valid && state->key[depth] == key[depth])
+		depth++;
+
+	memcpy(array_s, state->levels[depth], N);
+	j = state->j[depth];
+
+	// Iterations below the key size update the snapshots, the rest is plain KSA
+	for (i = depth; i < key_size - 1; i++) {
+		j = (j + array_s[i] + key[i]) % N;
+		swap(&array_s[i], &array_s[j]);
+		memcpy(state->levels[i + 1], array_s, N);
+		state->j[i + 1] = j;
+		state->key[i] = key[i];
+	}
+	state->valid = key_size - 1;
+
+	for (; i < N; i++) {
+		j = (j + array_s[i] + key[i % key_size]) % N;
+		swap(&array_s[i], &array_s[j]);
+	}
+	return 0;
+}
+
+int prga(uint8_t* array_s, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size) {
+	RC4_TRACE2(prga_entry, 0, plaintext_size);
+	int result = prga_n<N>(array_s, plaintext, ciphertext, plaintext_size);
+	RC4_TRACE1(prga_return, plaintext_size);
+	return result;
+}
+
+int prga_keystream(uint8_t* array_s, uint8_t* keystream, uint32_t keystream_size) {
+	RC4_TRACE2(prga_entry, 1, keystream_size);
+	int result = prga_keystream_n<N>(array_s, keystream, keystream_size);
+	RC4_TRACE1(prga_return, keystream_size);
+	return result;
+}
+
+// Returns the number of leading keystream bytes that match (stops at the first mismatch)
+uint32_t prga_compare(uint8_t* array_s, uint8_t* keystream, uint32_t keystream_size) {
+	uint32_t i = 0;
+	uint32_t j = 0;
+
+	for (uint32_t n = 0; n < keystream_size; n++) {
+		i = (i + 1) % N;
+		j = (j + array_s[i]) % N;
+		swap(&array_s[i], &array_s[j]);
+		if (array_s[(array_s[i] + array_s[j]) % N] != keystream[n])
+			return n;
+	}
+	return keystream_size;
+}
+
+// S1 = KSA(key), S2 = KSA(key2) with key2 = the first 256 keystream bytes of S1
+// (generated on a copy, so both S-boxes start from their post-KSA state)
+int rc4a_ksa(uint8_t* array_s1, uint8_t* array_s2, uint8_t* key, uint16_t key_size) {
+	uint8_t key2[N];
+
+	ksa(array_s1, key, key_size);
+	memcpy(array_s2, array_s1, N);
+	prga_keystream(array_s2, key2, N);
+	ksa(array_s2, key2, N);
+	return 0;
+}
+
+int rc4a_prga(uint8_t* array_s1, uint8_t* array_s2, uint8_t* plaintext, uint8_t* ciphertext, uint32_t plaintext_size) {
+	uint32_t i = 0;
+	uint32_t j1 = 0;
+	uint32_t j2 = 0;
+	uint32_t n = 0;
+
+	// Every round advances both S-boxes, S1 selects from S2 and the other way round
+	for (n = 0; n + 1 < plaintext_size; n += 2) {
+		i = (i + 1) % N;
+		j1 = (j1 + array_s1[i]) % N;
+		swap(&array_s1[i], &array_s1[j1]);
+		ciphertext[n] = array_s2[(array_s1[i] + array_s1[j1]) % N] ^ plaintext[n];
+		j2 = (j2 + array_s2[i]) % N;
+		swap(&array_s2[i], &array_s2[j2]);
+		ciphertext[n + 1] = array_s1[(array_s2[i] + array_s2[j2]) % N] ^ plaintext[n + 1];
+	}
+
+	// Odd size --> only the first half of the last round is used
+	if (n < plaintext_size) {
+		i = (i + 1) % N;
+		j1 = (j1 + array_s1[i]) % N;
+		swap(&array_s1[i], &array_s1[j1]);
+		ciphertext[n] = array_s2[(array_s1[i] + array_s1[j1]) % N] ^ plaintext[n];
+	}
+	return 0;
+}
+
+int rc4_init(rc4_ctx* ctx, uint8_t* key, uint16_t key_size) {
+	// Input Validation
+	if (key_size == 0 || key_size > 32) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+	ksa(ctx->S, key, key_size);
+	ctx->i = 0;
+	ctx->j = 0;
+	return 0;
+}
+
+void encrypt_inplace(rc4_ctx* __restrict ctx, uint8_t* __restrict buf, uint64_t len) {
+	uint8_t* __restrict array_s = ctx->S;
+	uint32_t i = ctx->i;
+	uint32_t j = ctx->j;
+
+	for (uint64_t n = 0; n < len; n++) {
+		i = (i + 1) % N;
+		uint8_t si = array_s[i];
+		j = (j + si) % N;
+		uint8_t sj = array_s[j];
+		array_s[i] = sj;
+		array_s[j] = si;
+		buf[n] ^= array_s[(si + sj) % N];
+	}
+	ctx->i = i;
+	ctx->j = j;
+}
+
+typedef void (*rc4_crypt_kernel)(rc4_ctx* __restrict, const uint8_t* __restrict, uint8_t* __restrict, uint64_t);
+
+static rc4_crypt_kernel width_kernel(int width) {
+	switch (width) {
+	case 2: return rc4_crypt_w<uint16_t>;
+	case 4: return rc4_crypt_w<uint32_t>;
+	default: return rc4_crypt_w<uint8_t>;
+	}
+}
+
+// Best of 5 runs over 64 KiB per width, about a millisecond at startup
+static int calibrate_width() {
+	const uint32_t size = 64 * 1024;
+	static uint8_t in[size];
+	static uint8_t out[size];
+	uint8_t key[16] = { 0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf, 0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36 };
+	int widths[3] = { 1, 2, 4 };
+	int best_width = 1;
+	int64_t best_ns = INT64_MAX;
+	rc4_ctx ctx;
+
+	for (int width : widths) {
+		rc4_crypt_kernel kernel = width_kernel(width);
+		for (int run = 0; run < 5; run++) {
+			rc4_init(&ctx, key, sizeof(key));
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			kernel(&ctx, in, out, size);
+			int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+			if (ns < best_ns) {
+				best_ns = ns;
+				best_width = width;
+			}
+		}
+	}
+	return best_width;
+}
+
+static int selected_width = 0;
+
+int rc4_width() {
+	static int calibrated = calibrate_width();
+	return selected_width ? selected_width : calibrated;
+}
+
+int rc4_set_width(int width) {
+	if (width != 1 && width != 2 && width != 4) {
+		printf("[!] The S-box element width has to be 1, 2 or 4 byte!\n");
+		return 1;
+	}
+	selected_width = width;
+	return 0;
+}
+
+void rc4_crypt_cached(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len) {
+	// Looked up per call, rc4_set_width() may change the width at any time
+	width_kernel(rc4_width())(ctx, in, out, len);
+}
+
+uint64_t rc4_stream_threshold() {
+#if defined(RC4_STREAM_THRESHOLD)
+	return RC4_STREAM_THRESHOLD;
+#else
+	static uint64_t threshold = 0;
+	if (threshold == 0) {
+		long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+		if (llc <= 0)
+			llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+		threshold = (llc > 0) ? (uint64_t) llc : 8 * 1024 * 1024;
+	}
+	return threshold;
+#endif
+}
+
+#if defined(__SSE2__)
+// Keystream in blocks of one cache line, XOR with the (prefetched) input and
+// write the line with non-temporal stores (whole lines only, 16 byte aligned)
+template <typename T>
+static uint64_t crypt_stream_lines(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len) {
+	T wide_s[sizeof(T) == 1 ? 1 : N];
+	T* __restrict array_s = wide_s;
+	uint32_t i = ctx->i;
+	uint32_t j = ctx->j;
+	alignas(64) uint8_t keystream[64];
+
+	if constexpr (sizeof(T) == 1) {
+		array_s = ctx->S;
+	}
+	else {
+		for (uint32_t k = 0; k < N; k++)
+			wide_s[k] = ctx->S[k];
+	}
+
+	uint64_t n = 0;
+	for (; n + 64 <= len; n += 64) {
+		_mm_prefetch((const char*) (in + n + 512), _MM_HINT_NTA);
+		for (uint32_t k = 0; k < 64; k++) {
+			i = (i + 1) % N;
+			T si = array_s[i];
+			j = (j + si) % N;
+			T sj = array_s[j];
+			array_s[i] = sj;
+			array_s[j] = si;
+			keystream[k] = in[n + k] ^ (uint8_t) array_s[(si + sj) % N];
+		}
+		for (uint32_t k = 0; k < 64; k += 16)
+			_mm_stream_si128((__m128i*) (out + n + k), _mm_load_si128((const __m128i*) (keystream + k)));
+	}
+	_mm_sfence();
+
+	if constexpr (sizeof(T) > 1) {
+		for (uint32_t k = 0; k < N; k++)
+			ctx->S[k] = (uint8_t) wide_s[k];
+	}
+	ctx->i = i;
+	ctx->j = j;
+	return n;
+}
+#endif
+
+void rc4_crypt_stream(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len) {
+#if defined(__SSE2__)
+	// Head: cached stores until out is 16 byte aligned
+	uint64_t head = (16 - ((uintptr_t) out & 15)) & 15;
+	if (head > len)
+		head = len;
+	rc4_crypt_w<uint8_t>(ctx, in, out, head);
+
+	uint64_t n = head;
+	switch (rc4_width()) {
+	case 2: n += crypt_stream_lines<uint16_t>(ctx, in + n, out + n, len - n); break;
+	case 4: n += crypt_stream_lines<uint32_t>(ctx, in + n, out + n, len - n); break;
+	default: n += crypt_stream_lines<uint8_t>(ctx, in + n, out + n, len - n); break;
+	}
+
+	// Tail: less than a cache line
+	rc4_crypt_w<uint8_t>(ctx, in + n, out + n, len - n);
+#else
+	rc4_crypt_cached(ctx, in, out, len);
+#endif
+}
+
+void rc4_crypt(rc4_ctx* __restrict ctx, const uint8_t* __restrict in, uint8_t* __restrict out, uint64_t len) {
+	if (len >= rc4_stream_threshold())
+		rc4_crypt_stream(ctx, in, out, len);
+	else
+		rc4_crypt_cached(ctx, in, out, len);
+}
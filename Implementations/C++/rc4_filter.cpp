@@ -0,0 +1,309 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Pipeline filter: stdin --> RC4 --> stdout
+
+	tar c dir | ./rc4_filter -z -k <hex key> | ssh host 'cat > dir.tar.rc4'
+	ssh host 'cat dir.tar.rc4' | ./rc4_filter -k <hex key> | tar x
+
+One rc4_ctx carries the keystream across all chunks, so the output equals
+rc4() over the whole stream. A regular file on stdin is mapped instead of
+read. Data read from a pipe lands in page-aligned chunks of the pipe size
+and is encrypted in place (that one copy is unavoidable, the cipher has to
+see every byte) and copied to stdout with write(). With -z and stdout being
+a pipe the encrypted pages are handed to it with vmsplice() instead.
+
+-z is opt-in because the pipe still references vmspliced pages until the
+reader consumes them. The chunks form a ring of RC4_FILTER_RING pipe-sized
+buffers and a buffer is only refilled after (RC4_FILTER_RING - 1) full pipes
+of newer data were spliced behind it. That holds as long as the reader
+read()s from the pipe (cat, ssh, tar, gzip); a reader that splice()s the
+pages onward (e.g. into a socket or file) can still reference them when
+they are overwritten and would send later ciphertext.
+
+Compile with this command:
+	g++ -O2 -pthread -o rc4_filter rc4_filter.cpp rc4_engine.cpp && ./rc4_filter -t
+*/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "rc4.h"
+
+using namespace std;
+
+#define RC4_FILTER_RING 4
+#define RC4_FILTER_PIPE_SIZE (1024 * 1024)
+
+
+void print_help() {
+	fprintf(stderr, "[*] Application usage:\n");
+	fprintf(stderr, "  -k <hex>     : key (1 - 32 byte, hex encoded)\n");
+	fprintf(stderr, "  -z           : vmsplice() the output into a stdout pipe instead of write(),\n");
+	fprintf(stderr, "                 only safe if the reader read()s the pipe (no splice() onward)\n");
+	fprintf(stderr, "  -t           : self-test (no stdin / stdout)\n");
+	fprintf(stderr, "  -h           : print this message\n");
+}
+
+int parse_hex(const char* hex, vector<uint8_t>& out) {
+	size_t len = strlen(hex);
+	if (len % 2 != 0)
+		return 1;
+	out.clear();
+	for (size_t i = 0; i < len; i += 2) {
+		char byte[3] = { hex[i], hex[i + 1], 0 };
+		char* end = NULL;
+		out.push_back((uint8_t) strtoul(byte, &end, 16));
+		if (*end != 0)
+			return 1;
+	}
+	return 0;
+}
+
+static bool is_pipe(int fd) {
+	struct stat info;
+	return fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+static int write_all(int fd, const uint8_t* data, size_t size) {
+	while (size > 0) {
+		ssize_t written = write(fd, data, size);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return 1;
+		data += written;
+		size -= written;
+	}
+	return 0;
+}
+
+// Hands the pages to the pipe, partial splices are continued
+static int vmsplice_all(int fd, uint8_t* data, size_t size) {
+	while (size > 0) {
+		struct iovec vector = { data, size };
+		ssize_t spliced = vmsplice(fd, &vector, 1, 0);
+		if (spliced < 0 && errno == EINTR)
+			continue;
+		if (spliced <= 0)
+			return 1;
+		data += spliced;
+		size -= spliced;
+	}
+	return 0;
+}
+
+// Regular file on stdin: encrypt from the mapping into chunks, no read() copy
+static int filter_mapped(rc4_ctx* ctx, int in_fd, int out_fd, uint64_t file_size, vector<uint8_t*>& ring, size_t chunk_size, bool splice_output) {
+	uint8_t* map = (uint8_t*) mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "[!] Could not mmap stdin!\n");
+		return 1;
+	}
+	madvise(map, file_size, MADV_SEQUENTIAL);
+
+	int status = 0;
+	uint32_t slot = 0;
+	for (uint64_t offset = 0; offset < file_size && status == 0; offset += chunk_size) {
+		size_t size = (file_size - offset < chunk_size) ? file_size - offset : chunk_size;
+		uint8_t* chunk = ring[slot];
+		slot = (slot + 1) % ring.size();
+		rc4_crypt(ctx, map + offset, chunk, size);
+		status = splice_output ? vmsplice_all(out_fd, chunk, size) : write_all(out_fd, chunk, size);
+	}
+	munmap(map, file_size);
+	return status;
+}
+
+// Returns 0 on success
+static int filter(int in_fd, int out_fd, uint8_t* key, uint16_t key_size, bool zero_copy) {
+	rc4_ctx ctx;
+	if (rc4_init(&ctx, key, key_size) != 0)
+		return 1;
+
+	// Larger pipes --> fewer syscalls, the chunk size follows the pipe size
+	bool splice_output = zero_copy && is_pipe(out_fd);
+	size_t chunk_size = RC4_FILTER_PIPE_SIZE;
+	if (splice_output) {
+		fcntl(out_fd, F_SETPIPE_SZ, RC4_FILTER_PIPE_SIZE);
+		int pipe_size = fcntl(out_fd, F_GETPIPE_SZ);
+		if (pipe_size > 0)
+			chunk_size = pipe_size;
+	}
+	if (is_pipe(in_fd))
+		fcntl(in_fd, F_SETPIPE_SZ, RC4_FILTER_PIPE_SIZE);
+
+	uint8_t* ring_memory = (uint8_t*) mmap(NULL, chunk_size * RC4_FILTER_RING, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring_memory == MAP_FAILED) {
+		fprintf(stderr, "[!] Could not allocate the chunk ring!\n");
+		return 1;
+	}
+	vector<uint8_t*> ring;
+	for (uint32_t slot = 0; slot < RC4_FILTER_RING; slot++)
+		ring.push_back(ring_memory + slot * chunk_size);
+
+	int status = 0;
+	struct stat info;
+	if (fstat(in_fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && lseek(in_fd, 0, SEEK_CUR) == 0) {
+		status = filter_mapped(&ctx, in_fd, out_fd, info.st_size, ring, chunk_size, splice_output);
+	}
+	else {
+		uint32_t slot = 0;
+		bool eof = false;
+		while (!eof && status == 0) {
+			// Fill a whole chunk, the ring distance argument needs full pipes
+			uint8_t* chunk = ring[slot];
+			slot = (slot + 1) % RC4_FILTER_RING;
+			size_t size = 0;
+			while (size < chunk_size) {
+				ssize_t received = read(in_fd, chunk + size, chunk_size - size);
+				if (received < 0 && errno == EINTR)
+					continue;
+				if (received < 0) {
+					fprintf(stderr, "[!] Could not read from stdin!\n");
+					status = 1;
+				}
+				if (received <= 0) {
+					eof = true;
+					break;
+				}
+				size += received;
+			}
+			if (size == 0 || status != 0)
+				break;
+
+			encrypt_inplace(&ctx, chunk, size);
+			status = splice_output ? vmsplice_all(out_fd, chunk, size) : write_all(out_fd, chunk, size);
+		}
+	}
+	if (status != 0 && errno == EPIPE)
+		fprintf(stderr, "[!] stdout was closed!\n");
+
+	// vmspliced pages keep their own references, unmapping is fine
+	munmap(ring_memory, chunk_size * RC4_FILTER_RING);
+	return status;
+}
+
+// Pipes on both sides, several chunks, compared against rc4() over the whole stream
+static int self_test(bool zero_copy) {
+	const uint32_t size = 5 * 1024 * 1000 + 123;
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[32] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+	vector<uint8_t> plaintext(size);
+	vector<uint8_t> expected(size);
+	vector<uint8_t> received(size);
+	for (uint32_t n = 0; n < size; n++)
+		plaintext[n] = (uint8_t) (n * 31 + (n >> 8));
+	rc4(32, size, key, plaintext.data(), expected.data());
+
+	int input[2];
+	int output[2];
+	if (pipe(input) != 0 || pipe(output) != 0) {
+		fprintf(stderr, "[!] Could not create the test pipes!\n");
+		return 1;
+	}
+
+	// Writer in small uneven pieces, reader with read() like cat / ssh
+	std::thread writer([&]() {
+		for (uint32_t offset = 0; offset < size; offset += 7777)
+			write_all(input[1], plaintext.data() + offset, (size - offset < 7777) ? size - offset : 7777);
+		close(input[1]);
+	});
+	atomic<size_t> total(0);
+	std::thread reader([&]() {
+		size_t done = 0;
+		for (;;) {
+			ssize_t got = read(output[0], received.data() + done, size - done);
+			if (got <= 0)
+				break;
+			done += got;
+		}
+		total = done;
+	});
+
+	int status = filter(input[0], output[1], key, 32, zero_copy);
+	close(output[1]);
+	writer.join();
+	reader.join();
+	close(input[0]);
+	close(output[0]);
+
+	int error = (status != 0 || total != size || memcmp(received.data(), expected.data(), size) != 0) ? 1 : 0;
+	fprintf(stderr, "[*] %s output: %zu of %u byte, ", zero_copy ? "vmsplice()" : "write()", (size_t) total, size);
+	fprintf(stderr, "%s\n", error ? "mismatch" : "matches rc4()");
+	return error;
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	const char* key_hex = NULL;
+	bool zero_copy = false;
+	bool test = false;
+	vector<uint8_t> key;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_hex = argv[++i]; }
+		else if (strcmp(argv[i], "-z") == 0) { zero_copy = true; }
+		else if (strcmp(argv[i], "-t") == 0) { test = true; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	if (test) {
+		int error = self_test(true) + self_test(false);
+		fprintf(stderr, "---- ---- ---- ---- ---- ---- ---- ----\n");
+		fprintf(stderr, error == 0 ? "[*] ... PASSED ...\n" : "[!] ... FAILED ...\n");
+		fprintf(stderr, "---- ---- ---- ---- ---- ---- ---- ----\n");
+		return error;
+	}
+
+	// Input Validation
+	if (key_hex == NULL) {
+		print_help();
+		return 1;
+	}
+	if (parse_hex(key_hex, key) != 0 || key.size() == 0 || key.size() > 32) {
+		fprintf(stderr, "[!] The key has to be 1 - 32 byte of hex!\n");
+		return 1;
+	}
+
+	return filter(STDIN_FILENO, STDOUT_FILENO, key.data(), key.size(), zero_copy);
+}
@@ -0,0 +1,98 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <cstring>
+#include <numa.h>
+#include <numaif.h>
+#include "rc4_numa.h"
+
+static bool numa_enabled() {
+	static int available = numa_available();
+	return available >= 0;
+}
+
+int rc4_numa_nodes() {
+	if (!numa_enabled())
+		return 1;
+	return numa_max_node() + 1;
+}
+
+int rc4_numa_node_of(const void* address) {
+	int node = 0;
+	if (!numa_enabled() || address == NULL)
+		return 0;
+	if (get_mempolicy(&node, NULL, 0, (void*) address, MPOL_F_NODE | MPOL_F_ADDR) != 0)
+		return 0;
+	return (node >= 0 && node < rc4_numa_nodes()) ? node : 0;
+}
+
+int rc4_numa_node_cpus(int node) {
+	if (!numa_enabled())
+		return 0;
+	struct bitmask* cpus = numa_allocate_cpumask();
+	int count = 0;
+	if (numa_node_to_cpus(node, cpus) == 0)
+		count = numa_bitmask_weight(cpus);
+	numa_free_cpumask(cpus);
+	return count;
+}
+
+int rc4_numa_bind_thread(int node) {
+	if (!numa_enabled())
+		return 0;
+	if (numa_run_on_node(node) != 0) {
+		printf("[!] Could not run on NUMA node %d!\n", node);
+		return 1;
+	}
+	numa_set_preferred(node);
+	return 0;
+}
+
+int rc4_numa_buffer_alloc(rc4_buffer* buffer, size_t size, int node) {
+	if (rc4_buffer_alloc(buffer, size) != 0)
+		return 1;
+	if (numa_enabled())
+		numa_tonode_memory(buffer->data, buffer->mapped, node);
+	// First touch after the policy is set places the pages
+	memset(buffer->data, 0, buffer->size);
+	return 0;
+}
+
+static int numa_slab_alloc(rc4_buffer* slab, size_t size, void* context) {
+	return rc4_numa_buffer_alloc(slab, size, *(int*) context);
+}
+
+void rc4_numa_pool_init(rc4_numa_pool* pool, int node) {
+	pool->node = node;
+	rc4_slab_pool_init(&pool->slabs, RC4_NUMA_POOL_MAX_SHIFT, numa_slab_alloc, &pool->node, &pool->lock);
+}
+
+void* rc4_numa_pool_alloc(rc4_numa_pool* pool, size_t size) {
+	return rc4_slab_pool_alloc(&pool->slabs, size);
+}
+
+void rc4_numa_pool_free(rc4_numa_pool* pool, void* block, size_t size) {
+	rc4_slab_pool_free(&pool->slabs, block, size);
+}
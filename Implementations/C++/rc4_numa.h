@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+NUMA helpers (libnuma) for the batch workers and benchmarks
+
+Jobs are routed to the node that owns the ciphertext pages, workers run on
+the CPUs of their node and buffers can be placed on a node explicitly. On
+hosts without NUMA support everything reports a single node 0.
+
+rc4_numa_pool hands out short-lived buffers (request payloads) bound to one
+node: an rc4_slab_pool (rc4_arena.h) with size classes up to 16 MiB, slabs
+from rc4_numa_buffer_alloc() and a lock, so a block may be freed by any
+thread.
+*/
+
+#ifndef __RC4_NUMA_H__
+#define __RC4_NUMA_H__
+
+#include <stddef.h>
+#include <mutex>
+#include "rc4_arena.h"
+
+#define RC4_NUMA_POOL_MAX_SHIFT 24  // 16 MiB, larger requests fail
+
+struct rc4_numa_pool {
+	std::mutex lock;
+	int node = 0;
+	rc4_slab_pool slabs;
+};
+
+int rc4_numa_nodes();
+int rc4_numa_node_of(const void* address);
+int rc4_numa_node_cpus(int node);
+// Restricts the calling thread to the CPUs of the node and prefers its memory
+int rc4_numa_bind_thread(int node);
+// rc4_buffer_alloc() with the pages bound to and faulted in on the node
+int rc4_numa_buffer_alloc(rc4_buffer* buffer, size_t size, int node);
+
+void rc4_numa_pool_init(rc4_numa_pool* pool, int node);
+void* rc4_numa_pool_alloc(rc4_numa_pool* pool, size_t size);
+void rc4_numa_pool_free(rc4_numa_pool* pool, void* block, size_t size);
+
+#endif
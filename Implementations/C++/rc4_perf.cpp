@@ -0,0 +1,160 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "rc4_perf.h"
+
+static const char* counter_names[RC4_PERF_COUNTERS] = {
+	"cycles",
+	"instructions",
+	"L1D misses",
+	"branch misses",
+	"store fwd stalls"
+};
+
+static bool is_intel() {
+	char line[256];
+	bool intel = false;
+	FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+	if (cpuinfo == NULL)
+		return false;
+	while (fgets(line, sizeof(line), cpuinfo) != NULL) {
+		if (strncmp(line, "vendor_id", 9) == 0) {
+			intel = (strstr(line, "GenuineIntel") != NULL);
+			break;
+		}
+	}
+	fclose(cpuinfo);
+	return intel;
+}
+
+// Opens a counter in the group of leader (or a new group if leader is -1)
+static int open_counter(int leader, uint32_t type, uint64_t config) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = (leader < 0) ? 1 : 0;   // members follow the leader
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+static void add_counter(rc4_perf* perf, int counter, uint32_t type, uint64_t config) {
+	perf->fd[counter] = open_counter(perf->leader, type, config);
+	if (perf->fd[counter] < 0)
+		return;
+	if (perf->leader < 0)
+		perf->leader = perf->fd[counter];
+	perf->order[perf->available++] = counter;
+}
+
+int rc4_perf_open(rc4_perf* perf) {
+	memset(perf, 0, sizeof(rc4_perf));
+	perf->leader = -1;
+	for (int c = 0; c < RC4_PERF_COUNTERS; c++)
+		perf->fd[c] = -1;
+
+	add_counter(perf, RC4_PERF_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	add_counter(perf, RC4_PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	add_counter(perf, RC4_PERF_L1D_MISSES, PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	add_counter(perf, RC4_PERF_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	if (is_intel())
+		add_counter(perf, RC4_PERF_STORE_FORWARD, PERF_TYPE_RAW, 0x0203);
+
+	if (perf->available == 0) {
+		printf("[!] perf_event_open failed, no hardware counters available (check /proc/sys/kernel/perf_event_paranoid)!\n");
+		return 1;
+	}
+	return 0;
+}
+
+void rc4_perf_start(rc4_perf* perf) {
+	if (perf->leader < 0)
+		return;
+	ioctl(perf->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void rc4_perf_stop(rc4_perf* perf) {
+	// PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, value[nr]
+	uint64_t data[3 + RC4_PERF_COUNTERS];
+
+	memset(perf->values, 0, sizeof(perf->values));
+	perf->time_enabled = 0;
+	perf->time_running = 0;
+	if (perf->leader < 0)
+		return;
+	ioctl(perf->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	ssize_t size = read(perf->leader, data, sizeof(data));
+	if (size < (ssize_t) (3 * sizeof(uint64_t)) || data[0] != (uint64_t) perf->available)
+		return;
+
+	perf->time_enabled = data[1];
+	perf->time_running = data[2];
+	if (perf->time_running == 0)
+		return;
+	// Multiplexed --> extrapolate to the enabled time
+	double scale = (double) perf->time_enabled / perf->time_running;
+	for (int n = 0; n < perf->available; n++)
+		perf->values[perf->order[n]] = (uint64_t) (data[3 + n] * scale);
+}
+
+void rc4_perf_print(rc4_perf* perf, const char* label, uint64_t bytes) {
+	printf("[*] %s counters (%llu byte):\n", label, (unsigned long long) bytes);
+	if (perf->time_running == 0) {
+		printf("    the counter group was never scheduled on the PMU, no values\n");
+		return;
+	}
+	if (perf->time_running < perf->time_enabled)
+		printf("    multiplexed: counted %.1f%% of the time, values are scaled\n", 100.0 * perf->time_running / perf->time_enabled);
+	for (int c = 0; c < RC4_PERF_COUNTERS; c++) {
+		if (perf->fd[c] < 0) {
+			printf("    %-17s: n/a\n", counter_names[c]);
+			continue;
+		}
+		printf("    %-17s: %14llu (%.4f per byte)\n", counter_names[c], (unsigned long long) perf->values[c],
+			bytes ? (double) perf->values[c] / bytes : 0.0);
+	}
+	if (perf->fd[RC4_PERF_CYCLES] >= 0 && perf->fd[RC4_PERF_INSTRUCTIONS] >= 0 && perf->values[RC4_PERF_CYCLES] > 0)
+		printf("    %-17s: %.3f\n", "IPC", (double) perf->values[RC4_PERF_INSTRUCTIONS] / perf->values[RC4_PERF_CYCLES]);
+}
+
+void rc4_perf_close(rc4_perf* perf) {
+	// Members first, the leader last
+	for (int n = perf->available - 1; n >= 0; n--) {
+		close(perf->fd[perf->order[n]]);
+		perf->fd[perf->order[n]] = -1;
+	}
+	perf->leader = -1;
+	perf->available = 0;
+}
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __RC4_PERF_H__
+#define __RC4_PERF_H__
+
+#include <stdint.h>
+
+// Hardware performance counters (perf_event_open) for the speed tests.
+// The counters form one group under the first one that opens, so they are
+// scheduled together and their ratios (IPC, misses per byte) stay
+// consistent. An event the PMU does not know (e.g. store forwarding) is
+// left out of the group. If the kernel multiplexes the group, the values
+// are scaled by time_enabled / time_running.
+enum rc4_perf_counter {
+	RC4_PERF_CYCLES = 0,
+	RC4_PERF_INSTRUCTIONS,
+	RC4_PERF_L1D_MISSES,
+	RC4_PERF_BRANCH_MISSES,
+	RC4_PERF_STORE_FORWARD,     // Intel LD_BLOCKS.STORE_FORWARD (raw 0x0203), n/a elsewhere
+	RC4_PERF_COUNTERS
+};
+
+struct rc4_perf {
+	int fd[RC4_PERF_COUNTERS];
+	int leader;                 // group leader fd, -1 if no counter opened
+	int order[RC4_PERF_COUNTERS];   // counter index per position in the group read
+	uint64_t values[RC4_PERF_COUNTERS];     // scaled
+	uint64_t time_enabled;
+	uint64_t time_running;
+	int available;              // number of opened counters
+};
+
+int rc4_perf_open(rc4_perf* perf);
+void rc4_perf_start(rc4_perf* perf);
+void rc4_perf_stop(rc4_perf* perf);
+void rc4_perf_print(rc4_perf* perf, const char* label, uint64_t bytes);
+void rc4_perf_close(rc4_perf* perf);
+
+#endif
@@ -0,0 +1,251 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Reduced-state RC4 experiments (N = 16, 32, 64, 128, 256)
+
+Runs the ksa_n() / prga_keystream_n() templates for the selected state size
+over the complete keyspace of key_size words (every word 0 .. N-1) and counts
+the per-position keystream word frequencies. The state size is picked at run
+time from the precompiled instantiations, no recompilation required.
+
+Compile with this command:
+	g++ -O2 -pthread -o rc4_reduced rc4_reduced.cpp rc4_engine.cpp && ./rc4_reduced
+*/
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4.h"
+
+using namespace std;
+
+#define REDUCED_MAX_KEY_SIZE 16
+#define REDUCED_MAX_POSITIONS 64
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  (no arguments) : run the self test\n");
+	printf("  -n <size>      : state size (16, 32, 64, 128 or 256, default 16)\n");
+	printf("  -k <words>     : key size in words, all N^k keys get enumerated (default 4)\n");
+	printf("  -K <words>     : keystream positions to analyse (default 8)\n");
+	printf("  -t <threads>   : worker threads (default: all cores)\n");
+	printf("  -h             : print this message\n");
+}
+
+template <uint32_t SN>
+static void enumerate_worker(uint64_t first, uint64_t last, uint32_t key_size, uint32_t positions, uint64_t* histogram) {
+	uint8_t array_s[SN];
+	uint8_t key[REDUCED_MAX_KEY_SIZE];
+	uint8_t keystream[REDUCED_MAX_POSITIONS];
+
+	for (uint64_t index = first; index < last; index++) {
+		uint64_t value = index;
+		for (uint32_t w = 0; w < key_size; w++) {
+			key[w] = value % SN;
+			value /= SN;
+		}
+		ksa_n<SN>(array_s, key, key_size);
+		prga_keystream_n<SN>(array_s, keystream, positions);
+		for (uint32_t p = 0; p < positions; p++)
+			histogram[p * SN + keystream[p]]++;
+	}
+}
+
+template <uint32_t SN>
+static int enumerate(uint32_t key_size, uint32_t positions, unsigned threads) {
+	uint64_t keys = 1;
+	for (uint32_t w = 0; w < key_size; w++) {
+		keys *= SN;
+		if (keys > (1ULL << 40)) {
+			printf("[!] %u^%u keys is too large for an exhaustive run!\n", SN, key_size);
+			return 1;
+		}
+	}
+
+	vector<vector<uint64_t>> histograms(threads, vector<uint64_t>(positions * SN, 0));
+	vector<std::thread> workers;
+	uint64_t per_thread = (keys + threads - 1) / threads;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threads; t++) {
+		uint64_t first = t * per_thread;
+		uint64_t last = (first + per_thread < keys) ? first + per_thread : keys;
+		if (first >= last)
+			break;
+		workers.push_back(std::thread(enumerate_worker<SN>, first, last, key_size, positions, histograms[t].data()));
+	}
+	for (auto& w : workers)
+		w.join();
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1e6;
+
+	for (unsigned t = 1; t < workers.size(); t++) {
+		for (size_t n = 0; n < histograms[0].size(); n++)
+			histograms[0][n] += histograms[t][n];
+	}
+
+	printf("[*] N = %u, %u word keys: %llu keys in %.2f seconds (%.0f keys/s)\n", SN, key_size, (unsigned long long) keys, seconds, keys / seconds);
+	printf("[*] Position  most frequent word  ratio to 1/N  least frequent word  ratio to 1/N\n");
+	for (uint32_t p = 0; p < positions; p++) {
+		uint64_t* counts = &histograms[0][p * SN];
+		uint32_t max_word = 0;
+		uint32_t min_word = 0;
+		for (uint32_t w = 1; w < SN; w++) {
+			if (counts[w] > counts[max_word])
+				max_word = w;
+			if (counts[w] < counts[min_word])
+				min_word = w;
+		}
+		double expected = (double) keys / SN;
+		printf("[*] %8u  %4u                %12.4f  %4u                 %12.4f\n", p + 1,
+			max_word, counts[max_word] / expected, min_word, counts[min_word] / expected);
+	}
+	return 0;
+}
+
+template <uint32_t SN>
+static int check_vector(uint8_t* key, uint16_t key_size, const uint8_t* known_keystream) {
+	uint8_t array_s[SN];
+	uint8_t keystream[16];
+	int error = 0;
+
+	ksa_n<SN>(array_s, key, key_size);
+	prga_keystream_n<SN>(array_s, keystream, 16);
+	printf("[*] N = %3u keystream: ", SN);
+	for (int n = 0; n < 16; n++) {
+		printf("%u ", keystream[n]);
+		if (keystream[n] != known_keystream[n])
+			error += 1;
+	}
+	printf("\n");
+	return error;
+}
+
+static int self_test(unsigned threads) {
+	int i = 0;
+	int error = 0;
+
+	// The N = 256 instantiation has to be plain RC4
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[32] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+	// 3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595
+	uint8_t plaintext[32] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2,
+			0xe0, 0xf8, 0x51, 0x2c, 0xb3, 0x5a, 0x75, 0x79,
+			0xfd, 0x79, 0x57, 0x5c, 0xf2, 0x87, 0xc5, 0x95
+	};
+	// 2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179
+	uint8_t known_ciphertext[32] = {
+			0x22, 0x80, 0xc9, 0x67, 0x6c, 0x8f, 0x5c, 0x52,
+			0xab, 0xa8, 0xd4, 0x26, 0x11, 0xf8, 0x5e, 0x7c,
+			0xa9, 0x61, 0xa2, 0x11, 0x7d, 0x3c, 0xfc, 0x82,
+			0x36, 0xa6, 0x05, 0x1b, 0xbf, 0xc5, 0xf1, 0x79
+	};
+	uint8_t array_s[N];
+	uint8_t ciphertext[32];
+	ksa_n<N>(array_s, key, 32);
+	prga_n<N>(array_s, plaintext, ciphertext, 32);
+	for (i = 0; i < 32; i++) {
+		if (ciphertext[i] != known_ciphertext[i])
+			error += 1;
+	}
+
+	// Reduced states (generated with an independent Python implementation)
+	uint8_t key_16[4] = { 1, 2, 3, 4 };
+	const uint8_t keystream_16[16] = { 7, 6, 3, 15, 15, 13, 8, 1, 14, 10, 13, 12, 6, 10, 3, 5 };
+	uint8_t key_64[3] = { 0x31, 0x07, 0x2a };
+	const uint8_t keystream_64[16] = { 44, 63, 30, 24, 48, 39, 24, 31, 45, 0, 16, 8, 10, 6, 41, 37 };
+	uint8_t key_24[2] = { 5, 11 }; // not a power of two --> modulo path
+	const uint8_t keystream_24[16] = { 7, 3, 14, 13, 14, 15, 17, 14, 8, 0, 16, 9, 7, 10, 9, 7 };
+	error += check_vector<16>(key_16, 4, keystream_16);
+	error += check_vector<64>(key_64, 3, keystream_64);
+	error += check_vector<24>(key_24, 2, keystream_24);
+
+	// Exhaustive N = 16 run over all 16^4 keys
+	error += enumerate<16>(4, 4, threads);
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	return error;
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	uint32_t state_size = 16;
+	uint32_t key_size = 4;
+	uint32_t positions = 8;
+	unsigned threads = std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+
+	if (argc == 1)
+		return self_test(threads) == 0 ? 0 : 1;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-n") == 0) && (i < (argc - 1))) { state_size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-K") == 0) && (i < (argc - 1))) { positions = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-t") == 0) && (i < (argc - 1))) { threads = strtoul(argv[++i], NULL, 0); }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	// Input Validation
+	if (key_size == 0 || key_size > REDUCED_MAX_KEY_SIZE || positions == 0 || positions > REDUCED_MAX_POSITIONS || threads == 0) {
+		print_help();
+		return 1;
+	}
+
+	switch (state_size) {
+	case 16: return enumerate<16>(key_size, positions, threads);
+	case 32: return enumerate<32>(key_size, positions, threads);
+	case 64: return enumerate<64>(key_size, positions, threads);
+	case 128: return enumerate<128>(key_size, positions, threads);
+	case 256: return enumerate<256>(key_size, positions, threads);
+	default:
+		printf("[!] Unsupported state size %u!\n", state_size);
+		return 1;
+	}
+}
@@ -0,0 +1,278 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstring>
+#include "rc4_ring.h"
+#include "rc4.h"
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t ring_data_offset(uint32_t entries) {
+	uint64_t page_size = sysconf(_SC_PAGESIZE);
+	uint64_t size = sizeof(rc4_ring_header) + entries * (sizeof(rc4_ring_sqe) + sizeof(rc4_ring_cqe));
+	return align_up(size, page_size);
+}
+
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+static uint32_t spin_limit() {
+	static const uint32_t limit = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? RC4_RING_SPIN_LIMIT : 0;
+	return limit;
+}
+
+static void futex_wait(uint32_t* address, uint32_t value) {
+	struct timespec timeout = { 0, 1000000 }; // 1 ms, the shutdown flag is checked between waits
+	syscall(SYS_futex, address, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+static void futex_wake(uint32_t* address) {
+	syscall(SYS_futex, address, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static void ring_setup(rc4_ring* ring, int fd, void* map, rc4_ring_header* header) {
+	ring->fd = fd;
+	ring->entries = header->entries;
+	ring->data_size = header->data_size;
+	ring->map_size = header->map_size;
+	ring->header = (rc4_ring_header*) map;
+	ring->sq = (rc4_ring_sqe*) (ring->header + 1);
+	ring->cq = (rc4_ring_cqe*) (ring->sq + header->entries);
+	ring->data = (uint8_t*) map + header->data_offset;
+}
+
+int rc4_ring_create(rc4_ring* ring, uint32_t entries, uint64_t data_size) {
+	if (entries == 0 || (entries & (entries - 1)) != 0) {
+		printf("[!] The ring size has to be a power of two!\n");
+		return 1;
+	}
+
+	uint64_t data_offset = ring_data_offset(entries);
+	uint64_t map_size = data_offset + align_up(data_size, sysconf(_SC_PAGESIZE));
+
+	// Sealed against shrinking, the worker maps the whole ring and must not run into SIGBUS
+	int fd = memfd_create("rc4_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0 || ftruncate(fd, map_size) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0) {
+		printf("[!] Could not create the ring memfd!\n");
+		if (fd >= 0)
+			close(fd);
+		return 1;
+	}
+	void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (map == MAP_FAILED) {
+		printf("[!] Could not mmap the ring!\n");
+		close(fd);
+		return 1;
+	}
+
+	rc4_ring_header* header = (rc4_ring_header*) map;
+	memset(header, 0, sizeof(*header));
+	header->entries = entries;
+	header->data_offset = data_offset;
+	header->data_size = data_size;
+	header->map_size = map_size;
+	__atomic_store_n(&header->magic, RC4_RING_MAGIC, __ATOMIC_RELEASE);
+
+	ring_setup(ring, fd, map, header);
+	return 0;
+}
+
+int rc4_ring_attach(rc4_ring* ring, int fd) {
+	rc4_ring_header header;
+	struct stat info;
+
+	// Seals first: the size check below only holds once the memfd cannot shrink anymore
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+		printf("[!] The RC4 ring is not sealed against shrinking (F_SEAL_SHRINK)!\n");
+		return 1;
+	}
+	if (pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header) || header.magic != RC4_RING_MAGIC) {
+		printf("[!] The file descriptor does not contain an RC4 ring!\n");
+		return 1;
+	}
+	if (header.entries == 0 || (header.entries & (header.entries - 1)) != 0 ||
+		header.data_offset != ring_data_offset(header.entries) || header.data_offset + header.data_size < header.data_offset ||
+		header.map_size < header.data_offset + header.data_size) {
+		printf("[!] The RC4 ring header is corrupt!\n");
+		return 1;
+	}
+	if (fstat(fd, &info) != 0 || header.map_size > (uint64_t) info.st_size) {
+		printf("[!] The RC4 ring is larger than its file descriptor!\n");
+		return 1;
+	}
+
+	void* map = mmap(NULL, header.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (map == MAP_FAILED) {
+		printf("[!] Could not mmap the ring!\n");
+		return 1;
+	}
+	ring_setup(ring, fd, map, &header);
+	return 0;
+}
+
+void rc4_ring_detach(rc4_ring* ring) {
+	if (ring->header != NULL)
+		munmap(ring->header, ring->map_size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	ring->fd = -1;
+	ring->header = NULL;
+}
+
+int rc4_ring_submit(rc4_ring* ring, rc4_ring_sqe* sqe) {
+	rc4_ring_header* header = ring->header;
+	uint32_t tail = header->sq_tail;
+
+	if (tail - __atomic_load_n(&header->sq_head, __ATOMIC_ACQUIRE) == ring->entries)
+		return 1;
+
+	ring->sq[tail & (ring->entries - 1)] = *sqe;
+	__atomic_store_n(&header->sq_tail, tail + 1, __ATOMIC_SEQ_CST);
+
+	// Only pay for the system call if the worker went to sleep
+	if (__atomic_load_n(&header->worker_sleeping, __ATOMIC_SEQ_CST))
+		futex_wake(&header->sq_tail);
+	return 0;
+}
+
+int rc4_ring_reap(rc4_ring* ring, rc4_ring_cqe* cqe) {
+	rc4_ring_header* header = ring->header;
+	uint32_t head = header->cq_head;
+
+	if (head == __atomic_load_n(&header->cq_tail, __ATOMIC_ACQUIRE))
+		return 1;
+
+	*cqe = ring->cq[head & (ring->entries - 1)];
+	__atomic_store_n(&header->cq_head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+int rc4_ring_wait(rc4_ring* ring, rc4_ring_cqe* cqe) {
+	rc4_ring_header* header = ring->header;
+	uint32_t spins = 0;
+
+	while (rc4_ring_reap(ring, cqe) != 0) {
+		if (__atomic_load_n(&header->shutdown, __ATOMIC_ACQUIRE))
+			return 1;
+		if (++spins < spin_limit()) {
+			cpu_relax();
+			continue;
+		}
+		// Same handshake as the worker, just on the CQ tail
+		uint32_t tail = header->cq_head;
+		__atomic_store_n(&header->client_sleeping, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&header->cq_tail, __ATOMIC_SEQ_CST) == tail)
+			futex_wait(&header->cq_tail, tail);
+		__atomic_store_n(&header->client_sleeping, 0, __ATOMIC_SEQ_CST);
+	}
+	return 0;
+}
+
+void rc4_ring_shutdown(rc4_ring* ring) {
+	__atomic_store_n(&ring->header->shutdown, 1, __ATOMIC_RELEASE);
+	futex_wake(&ring->header->sq_tail);
+}
+
+static int ring_process(rc4_ring* ring, rc4_ring_sqe* sqe) {
+	rc4_ctx ctx;
+
+	// Input Validation (the client is not trusted)
+	if (sqe->key_size == 0 || sqe->key_size > RC4_RING_MAX_KEY_SIZE)
+		return 1;
+	if (sqe->offset > ring->data_size || ring->data_size - sqe->offset < sqe->size)
+		return 1;
+
+	uint8_t* record = ring->data + sqe->offset;
+	if (sqe->op == RC4_RING_OP_KEYSTREAM)
+		memset(record, 0, sqe->size);
+	else if (sqe->op != RC4_RING_OP_ENCRYPT)
+		return 1;
+
+	rc4_init(&ctx, sqe->key, sqe->key_size);
+	encrypt_inplace(&ctx, record, sqe->size);
+	return 0;
+}
+
+void rc4_ring_serve(rc4_ring* ring, std::atomic<bool>* stop) {
+	rc4_ring_header* header = ring->header;
+	uint32_t mask = ring->entries - 1;
+	uint32_t spins = 0;
+	rc4_ring_sqe sqe;
+
+	while (!stop->load() && !__atomic_load_n(&header->shutdown, __ATOMIC_ACQUIRE)) {
+		uint32_t head = header->sq_head;
+		uint32_t tail = __atomic_load_n(&header->sq_tail, __ATOMIC_ACQUIRE);
+
+		if (head == tail) {
+			if (++spins < spin_limit()) {
+				cpu_relax();
+				continue;
+			}
+			// Idle --> announce the sleep, re-check and wait on the SQ tail
+			__atomic_store_n(&header->worker_sleeping, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&header->sq_tail, __ATOMIC_SEQ_CST) == tail)
+				futex_wait(&header->sq_tail, tail);
+			__atomic_store_n(&header->worker_sleeping, 0, __ATOMIC_SEQ_CST);
+			continue;
+		}
+		spins = 0;
+
+		// Copy the SQE out of the shared memory before validating it
+		sqe = ring->sq[head & mask];
+		__atomic_store_n(&header->sq_head, head + 1, __ATOMIC_RELEASE);
+		int status = ring_process(ring, &sqe);
+
+		// Wait for a free CQ slot
+		uint32_t cq_tail = header->cq_tail;
+		while (cq_tail - __atomic_load_n(&header->cq_head, __ATOMIC_ACQUIRE) == ring->entries) {
+			if (stop->load() || __atomic_load_n(&header->shutdown, __ATOMIC_ACQUIRE))
+				return;
+			sched_yield();
+		}
+		rc4_ring_cqe* cqe = &ring->cq[cq_tail & mask];
+		cqe->user_data = sqe.user_data;
+		cqe->status = status;
+		cqe->size = sqe.size;
+		__atomic_store_n(&header->cq_tail, cq_tail + 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&header->client_sleeping, __ATOMIC_SEQ_CST))
+			futex_wake(&header->cq_tail);
+	}
+}
@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Shared-memory submission / completion ring for zero-copy RC4 offload
+
+One memfd holds the ring header, the submission queue (SQ), the completion
+queue (CQ) and a data area. The client writes its records into the data
+area, pushes an SQE (key + offset + size) and the cipher worker encrypts the
+record in place with ksa() / prga() and pushes a CQE. No payload crosses a
+socket, the memfd only has to be shared once (e.g. via rc4d RC4D_OP_RING).
+rc4_ring_attach() only accepts memfds sealed with F_SEAL_SHRINK that are at
+least map_size bytes large, so the client cannot SIGBUS the worker.
+
+Each ring has exactly one producer (client) and one consumer (worker). Both
+sides busy-poll for RC4_RING_SPIN_LIMIT rounds before they sleep on a futex,
+so a busy ring never pays for a system call. On single core hosts spinning
+only steals the time slice of the other side, so they sleep right away.
+
+Memory layout:
+	rc4_ring_header                      (page aligned)
+	rc4_ring_sqe[entries]
+	rc4_ring_cqe[entries]
+	data[data_size]                      (page aligned)
+*/
+
+#ifndef __RC4_RING_H__
+#define __RC4_RING_H__
+
+#include <atomic>
+#include <stdint.h>
+
+#define RC4_RING_MAGIC 0x47525243 // "CRRG"
+#define RC4_RING_MAX_KEY_SIZE 32
+#define RC4_RING_SPIN_LIMIT 100000
+
+#define RC4_RING_OP_ENCRYPT 1
+#define RC4_RING_OP_KEYSTREAM 2
+
+struct rc4_ring_header {
+	uint32_t magic;
+	uint32_t entries;               // power of two
+	uint64_t data_offset;
+	uint64_t data_size;
+	uint64_t map_size;
+
+	alignas(64) uint32_t sq_head;   // written by the worker
+	alignas(64) uint32_t sq_tail;   // written by the client
+	alignas(64) uint32_t cq_head;   // written by the client
+	alignas(64) uint32_t cq_tail;   // written by the worker
+	alignas(64) uint32_t worker_sleeping;
+	uint32_t client_sleeping;
+	uint32_t shutdown;
+};
+
+struct rc4_ring_sqe {
+	uint64_t user_data;
+	uint64_t offset;                // relative to the data area
+	uint32_t size;
+	uint16_t op;
+	uint16_t key_size;
+	uint8_t key[RC4_RING_MAX_KEY_SIZE];
+};
+
+struct rc4_ring_cqe {
+	uint64_t user_data;
+	int32_t status;                 // 0 on success
+	uint32_t size;
+};
+
+struct rc4_ring {
+	int fd;
+	uint32_t entries;               // private copies, the shared header is not trusted
+	uint64_t data_size;
+	uint64_t map_size;
+	rc4_ring_header* header;
+	rc4_ring_sqe* sq;
+	rc4_ring_cqe* cq;
+	uint8_t* data;
+};
+
+// Setup (returns 0 on success)
+int rc4_ring_create(rc4_ring* ring, uint32_t entries, uint64_t data_size);
+int rc4_ring_attach(rc4_ring* ring, int fd);
+void rc4_ring_detach(rc4_ring* ring);
+
+// Client side (returns 0 on success, 1 if the ring is full / empty)
+int rc4_ring_submit(rc4_ring* ring, rc4_ring_sqe* sqe);
+int rc4_ring_reap(rc4_ring* ring, rc4_ring_cqe* cqe);
+int rc4_ring_wait(rc4_ring* ring, rc4_ring_cqe* cqe);   // blocks until a completion arrives (1 on shutdown)
+void rc4_ring_shutdown(rc4_ring* ring);
+
+// Worker side, serves the ring until rc4_ring_shutdown() or *stop is set
+void rc4_ring_serve(rc4_ring* ring, std::atomic<bool>* stop);
+
+#endif
@@ -0,0 +1,193 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Compile with this command:
+	g++ -O2 -pthread -o rc4_ring rc4_ring_tool.cpp rc4_ring.cpp rc4d_client.cpp rc4_engine.cpp && ./rc4_ring
+(with -s the ring gets served by a running rc4d instead of an in-process worker thread)
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4_ring.h"
+#include "rc4d.h"
+#include "rc4.h"
+
+using namespace std;
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  -s <path>  : let rc4d serve the ring (default: in-process worker thread)\n");
+	printf("  -n <count> : records for the latency test (default 100000)\n");
+	printf("  -r <bytes> : record size (default 64)\n");
+	printf("  -h         : print this message\n");
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	int error = 0;
+	const char* socket_path = NULL;
+	uint32_t records = 100000;
+	uint32_t record_size = 64;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { socket_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-n") == 0) && (i < (argc - 1))) { records = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-r") == 0) && (i < (argc - 1))) { record_size = strtoul(argv[++i], NULL, 0); }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+	if (records == 0 || record_size == 0) {
+		print_help();
+		return 1;
+	}
+
+	const uint16_t key_size = 32;
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[key_size] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+
+	const uint32_t entries = 64;
+	rc4_ring ring;
+	if (rc4_ring_create(&ring, entries, (uint64_t) entries * record_size) != 0)
+		return 1;
+
+	// Worker --> rc4d or a local thread
+	int sock = -1;
+	std::atomic<bool> stop(false);
+	std::thread worker;
+	if (socket_path != NULL) {
+		sock = rc4d_connect(socket_path);
+		if (sock < 0 || rc4d_attach_ring(sock, ring.fd) != 0) {
+			printf("[!] rc4d did not accept the ring!\n");
+			return 1;
+		}
+		printf("[*] Ring served by rc4d (%s)\n", socket_path);
+	}
+	else {
+		worker = std::thread([&]() {
+			rc4_ring worker_ring;
+			if (rc4_ring_attach(&worker_ring, dup(ring.fd)) == 0) {
+				rc4_ring_serve(&worker_ring, &stop);
+				rc4_ring_detach(&worker_ring);
+			}
+		});
+		printf("[*] Ring served by an in-process worker thread\n");
+	}
+
+	// Correctness: every record has to match rc4()
+	vector<uint8_t> plaintext(record_size);
+	vector<uint8_t> expected(record_size);
+	for (uint32_t n = 0; n < record_size; n++)
+		plaintext[n] = (uint8_t) (n * 13 + 1);
+	rc4(key_size, record_size, key, plaintext.data(), expected.data());
+
+	rc4_ring_sqe sqe;
+	rc4_ring_cqe cqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.op = RC4_RING_OP_ENCRYPT;
+	sqe.key_size = key_size;
+	sqe.size = record_size;
+	memcpy(sqe.key, key, key_size);
+
+	// Round trip latency (one record in flight)
+	vector<uint64_t> latency_ns(records);
+	for (uint32_t n = 0; n < records; n++) {
+		uint8_t* record = ring.data;
+		memcpy(record, plaintext.data(), record_size);
+		sqe.user_data = n;
+		sqe.offset = 0;
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		while (rc4_ring_submit(&ring, &sqe) != 0)
+			;
+		if (rc4_ring_wait(&ring, &cqe) != 0)
+			break;
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		latency_ns[n] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+		if (cqe.status != 0 || cqe.user_data != n || memcmp(record, expected.data(), record_size) != 0)
+			error += 1;
+	}
+	sort(latency_ns.begin(), latency_ns.end());
+	printf("[*] %u x %u byte records, round trip latency: p50 %.2f us / p99 %.2f us / max %.2f us\n", records, record_size,
+		latency_ns[records / 2] / 1000.0, latency_ns[(uint64_t) records * 99 / 100] / 1000.0, latency_ns[records - 1] / 1000.0);
+
+	// Throughput (ring kept full)
+	uint32_t submitted = 0;
+	uint32_t completed = 0;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	while (completed < records) {
+		while (submitted < records && submitted - completed < entries) {
+			sqe.user_data = submitted;
+			sqe.offset = (uint64_t) (submitted % entries) * record_size;
+			if (rc4_ring_submit(&ring, &sqe) != 0)
+				break;
+			submitted++;
+		}
+		if (rc4_ring_wait(&ring, &cqe) != 0)
+			break;
+		do {
+			if (cqe.status != 0)
+				error += 1;
+			completed++;
+		} while (rc4_ring_reap(&ring, &cqe) == 0);
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	float time_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0;
+	printf("[*] Pipelined: %.0f records/s (%.2f MB/s)\n", records / (time_ms / 1000), ((double) records * record_size / (1024 * 1000)) / (time_ms / 1000));
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+
+	rc4_ring_shutdown(&ring);
+	if (worker.joinable())
+		worker.join();
+	if (sock >= 0)
+		close(sock);
+	rc4_ring_detach(&ring);
+	return error == 0 ? 0 : 1;
+}
@@ -0,0 +1,333 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Thread scaling benchmark
+
+Runs independent streams (own key, own buffers) on 1, 2, 4 ... N threads,
+every thread pinned to its own CPU of the process affinity mask. Reports the
+aggregate throughput, the per-thread efficiency against the single thread
+run and the memory traffic (plaintext read + ciphertext write). With
+buffers larger than the last level cache the efficiency drops once the
+memory bandwidth saturates, run with a cache resident size (-s 65536) to
+get the compute-only scaling for comparison. -N adds a per NUMA node report
+with the buffers on the local and on a remote node.
+
+Compile with this command:
+	g++ -O2 -pthread -o rc4_scaling rc4_scaling.cpp rc4_batch.cpp rc4_engine.cpp rc4_arena.cpp rc4_numa.cpp -lnuma && ./rc4_scaling
+*/
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include "rc4.h"
+#include "rc4_batch.h"
+#include "rc4_arena.h"
+#include "rc4_numa.h"
+
+using namespace std;
+
+
+struct scaling_worker {
+	uint8_t key[32];
+	rc4_buffer plaintext_buffer;
+	rc4_buffer ciphertext_buffer;
+	uint8_t* plaintext;
+	uint8_t* ciphertext;
+	int cpu;
+	int node;               // >= 0 --> run on any CPU of the node instead of cpu
+};
+
+typedef void (*scaling_function)(scaling_worker* worker, uint16_t key_size, uint32_t size);
+
+struct scaling_engine {
+	const char* name;
+	scaling_function run;
+};
+
+static void run_rc4(scaling_worker* worker, uint16_t key_size, uint32_t size) {
+	rc4(key_size, size, worker->key, worker->plaintext, worker->ciphertext);
+}
+
+// The same bytes per iteration as run_rc4(), split over the lanes
+static void run_batch(scaling_worker* worker, uint16_t key_size, uint32_t size) {
+	rc4_job jobs[RC4_BATCH_LANES];
+	uint64_t lane_size = size / RC4_BATCH_LANES;
+	for (uint32_t lane = 0; lane < RC4_BATCH_LANES; lane++) {
+		jobs[lane].key = worker->key;
+		jobs[lane].key_size = key_size;
+		jobs[lane].plaintext = worker->plaintext + lane * lane_size;
+		jobs[lane].ciphertext = worker->ciphertext + lane * lane_size;
+		jobs[lane].size = (lane == RC4_BATCH_LANES - 1) ? size - lane * lane_size : lane_size;
+	}
+	rc4_batch(jobs, RC4_BATCH_LANES);
+}
+
+static const scaling_engine engines[] = {
+	{ "rc4", run_rc4 },
+	{ "batch", run_batch },
+};
+
+static vector<int> allowed_cpus() {
+	vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &set))
+				cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+static void pin_thread(int cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		printf("[!] Could not pin a thread to CPU %d!\n", cpu);
+}
+
+// Returns the aggregate throughput in byte per second
+static double run_threads(const scaling_engine* engine, vector<scaling_worker>& workers, uint16_t key_size, uint32_t size, uint32_t iterations) {
+	atomic<uint32_t> ready(0);
+	atomic<bool> go(false);
+	vector<std::thread> threads;
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		threads.push_back(std::thread([&, t]() {
+			scaling_worker* worker = &workers[t];
+			if (worker->node >= 0)
+				rc4_numa_bind_thread(worker->node);
+			else
+				pin_thread(worker->cpu);
+			// Warmup: page in the buffers on the pinned CPU
+			engine->run(worker, key_size, size);
+			ready.fetch_add(1);
+			while (!go.load())
+				std::this_thread::yield();
+			for (uint32_t n = 0; n < iterations; n++)
+				engine->run(worker, key_size, size);
+		}));
+	}
+	while (ready.load() < workers.size())
+		std::this_thread::yield();
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	go.store(true);
+	for (std::thread& thread : threads)
+		thread.join();
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	double seconds = std::chrono::duration<double>(end - begin).count();
+	return (double) size * iterations * workers.size() / seconds;
+}
+
+// Per node throughput with the buffers on the local node and on the next node
+static void numa_report(const scaling_engine* engine, uint16_t key_size, uint32_t size, uint32_t iterations, uint32_t max_threads) {
+	int nodes = rc4_numa_nodes();
+	printf("[*] NUMA: %d nodes\n", nodes);
+	printf("%8s %8s %14s %14s %12s\n", "node", "threads", "local MB/s", "remote MB/s", "remote/local");
+
+	for (int node = 0; node < nodes; node++) {
+		uint32_t count = rc4_numa_node_cpus(node);
+		if (count == 0 && nodes > 1)
+			continue;
+		if (count == 0 || count > max_threads)
+			count = max_threads;
+
+		double throughput[2] = { 0, 0 };
+		int placements = (nodes > 1) ? 2 : 1;
+		for (int placement = 0; placement < placements; placement++) {
+			int memory_node = (placement == 0) ? node : (node + 1) % nodes;
+			vector<scaling_worker> workers(count);
+			bool allocated = true;
+			for (uint32_t t = 0; t < count; t++) {
+				scaling_worker* worker = &workers[t];
+				for (uint32_t b = 0; b < 32; b++)
+					worker->key[b] = 0xae ^ (b * 0x3d);
+				worker->key[0] = t;
+				worker->cpu = -1;
+				worker->node = node;
+				if (rc4_numa_buffer_alloc(&worker->plaintext_buffer, size, memory_node) != 0 ||
+					rc4_numa_buffer_alloc(&worker->ciphertext_buffer, size, memory_node) != 0) {
+					allocated = false;
+					break;
+				}
+				worker->plaintext = worker->plaintext_buffer.data;
+				worker->ciphertext = worker->ciphertext_buffer.data;
+				memset(worker->plaintext, 'a', size);
+			}
+			if (allocated)
+				throughput[placement] = run_threads(engine, workers, key_size, size, iterations);
+			for (scaling_worker& worker : workers) {
+				rc4_buffer_free(&worker.plaintext_buffer);
+				rc4_buffer_free(&worker.ciphertext_buffer);
+			}
+		}
+
+		if (placements == 2)
+			printf("%8d %8u %14.2f %14.2f %11.1f%%\n", node, count, throughput[0] / 1e6, throughput[1] / 1e6,
+				throughput[0] > 0 ? 100.0 * throughput[1] / throughput[0] : 0);
+		else
+			printf("%8d %8u %14.2f %14s %12s\n", node, count, throughput[0] / 1e6, "-", "-");
+		fflush(stdout);
+	}
+}
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  -t <count>   : largest thread count (default: CPUs in the affinity mask)\n");
+	printf("  -s <size>    : buffer size per thread in byte (default 16 MiB)\n");
+	printf("  -i <count>   : iterations per thread (default 8)\n");
+	printf("  -k <size>    : key size in byte (default 16)\n");
+	printf("  -e <engine>  : rc4, batch or all (default all)\n");
+	printf("  -E <percent> : efficiency threshold for the saturation point (default 80)\n");
+	printf("  -N           : per NUMA node report (local vs remote buffers)\n");
+	printf("  -h           : print this message\n");
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	vector<int> cpus = allowed_cpus();
+	uint32_t max_threads = cpus.size();
+	uint32_t size = 16 * 1024 * 1024;
+	uint32_t iterations = 8;
+	uint16_t key_size = 16;
+	double threshold = 80.0;
+	string engine_name = "all";
+	bool numa = false;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-t") == 0) && (i < (argc - 1))) { max_threads = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-i") == 0) && (i < (argc - 1))) { iterations = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-e") == 0) && (i < (argc - 1))) { engine_name = argv[++i]; }
+		else if ((strcmp(argv[i], "-E") == 0) && (i < (argc - 1))) { threshold = strtod(argv[++i], NULL); }
+		else if (strcmp(argv[i], "-N") == 0) { numa = true; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	// Input Validation
+	if (key_size == 0 || key_size > 32) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+	if (max_threads == 0 || size < RC4_BATCH_LANES || iterations == 0 || cpus.empty()) {
+		print_help();
+		return 1;
+	}
+	if (max_threads > cpus.size())
+		printf("[!] %u threads on %zu CPUs, the CPUs get shared by several threads!\n", max_threads, cpus.size());
+
+	vector<uint32_t> thread_counts;
+	for (uint32_t count = 1; count < max_threads; count *= 2)
+		thread_counts.push_back(count);
+	thread_counts.push_back(max_threads);
+
+	// Per thread buffers and keys (the thread index in the first key byte)
+	vector<scaling_worker> all_workers(max_threads);
+	for (uint32_t t = 0; t < max_threads; t++) {
+		scaling_worker* worker = &all_workers[t];
+		for (uint32_t b = 0; b < 32; b++)
+			worker->key[b] = 0xae ^ (b * 0x3d);
+		worker->key[0] = t;
+		if (rc4_buffer_alloc(&worker->plaintext_buffer, size) != 0 || rc4_buffer_alloc(&worker->ciphertext_buffer, size) != 0) {
+			printf("[!] Could not allocate the buffers of thread %u!\n", t);
+			return 1;
+		}
+		worker->plaintext = worker->plaintext_buffer.data;
+		worker->ciphertext = worker->ciphertext_buffer.data;
+		memset(worker->plaintext, 'a', size);
+		worker->cpu = cpus[t % cpus.size()];
+		worker->node = -1;
+	}
+
+	printf("[*] %zu CPUs, %u byte per thread (%s), %u iterations, %u byte keys\n", cpus.size(), size,
+		rc4_buffer_pages(&all_workers[0].plaintext_buffer), iterations, key_size);
+	bool found_engine = false;
+	for (const scaling_engine& engine : engines) {
+		if (engine_name != "all" && engine_name != engine.name)
+			continue;
+		found_engine = true;
+
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+		printf("[*] Engine: %s\n", engine.name);
+		printf("%8s %14s %14s %12s %16s\n", "threads", "total MB/s", "per thread", "efficiency", "memory GB/s");
+
+		double single = 0;
+		double best = 0;
+		uint32_t best_threads = 0;
+		uint32_t saturation = 0;
+		for (uint32_t count : thread_counts) {
+			vector<scaling_worker> workers(all_workers.begin(), all_workers.begin() + count);
+			double throughput = run_threads(&engine, workers, key_size, size, iterations);
+			if (count == 1)
+				single = throughput;
+			double efficiency = 100.0 * throughput / (single * count);
+			printf("%8u %14.2f %14.2f %11.1f%% %16.3f\n", count, throughput / 1e6, throughput / 1e6 / count, efficiency,
+				2 * throughput / 1e9);
+			fflush(stdout);
+
+			if (throughput > best) {
+				best = throughput;
+				best_threads = count;
+			}
+			if (saturation == 0 && efficiency < threshold)
+				saturation = count;
+		}
+
+		printf("[*] Peak: %.2f MB/s with %u threads\n", best / 1e6, best_threads);
+		if (saturation != 0)
+			printf("[*] Efficiency drops below %.0f %% at %u threads (bandwidth or shared core saturation)\n", threshold, saturation);
+		else
+			printf("[*] Efficiency stays above %.0f %% up to %u threads\n", threshold, max_threads);
+
+		if (numa)
+			numa_report(&engine, key_size, size, iterations, max_threads);
+	}
+
+	for (scaling_worker& worker : all_workers) {
+		rc4_buffer_free(&worker.plaintext_buffer);
+		rc4_buffer_free(&worker.ciphertext_buffer);
+	}
+
+	if (!found_engine) {
+		printf("[!] Unknown engine %s!\n", engine_name.c_str());
+		return 1;
+	}
+	return 0;
+}
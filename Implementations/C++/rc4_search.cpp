@@ -0,0 +1,381 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Known-plaintext key search for short RC4 keys (authorized assessments / CTFs)
+
+The known keystream (plaintext ^ ciphertext) is checked against every
+candidate key of the keyspace:
+	- candidate key = fixed prefix || big endian counter (unknown_size byte)
+	- the keyspace is handed out in blocks of SEARCH_BLOCK_KEYS candidates
+	- every candidate runs ksa_prefix() and prga_compare(), which stops at the
+	  first keystream byte that does not match (255 / 256 candidates after one
+	  byte). Consecutive candidates share all but the last byte(s), so the KSA
+	  restores the snapshot of the shared prefix instead of starting over
+	- the progress (every candidate below the watermark has been checked) is
+	  written to the checkpoint file every SEARCH_CHECKPOINT_SECONDS
+
+Compile with this command:
+	g++ -O2 -pthread -o rc4_search rc4_search.cpp rc4_engine.cpp && ./rc4_search
+*/
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4.h"
+
+using namespace std;
+
+#define SEARCH_MAX_KEY_SIZE 32
+#define SEARCH_MAX_UNKNOWN_SIZE 7
+#define SEARCH_MAX_KEYSTREAM_SIZE 64
+#define SEARCH_BLOCK_KEYS (1ULL << 16)
+#define SEARCH_CHECKPOINT_SECONDS 10
+
+
+struct search_job {
+	uint8_t prefix[SEARCH_MAX_KEY_SIZE];
+	uint32_t prefix_size;
+	uint32_t unknown_size;
+	uint8_t keystream[SEARCH_MAX_KEYSTREAM_SIZE];
+	uint32_t keystream_size;
+	uint64_t keyspace;
+	bool find_all;
+
+	std::atomic<uint64_t> next_block;
+	std::atomic<uint64_t> keys_done;
+	std::atomic<bool> stop;
+	vector<std::atomic<uint64_t>>* in_progress;    // block per worker, UINT64_MAX --> idle
+
+	std::mutex found_lock;
+	vector<vector<uint8_t>> found;
+};
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  (no arguments) : run the self test (16 bit search with a known 24 bit prefix)\n");
+	printf("  -p <hex>       : known plaintext\n");
+	printf("  -c <hex>       : matching ciphertext (same length, max %d byte)\n", SEARCH_MAX_KEYSTREAM_SIZE);
+	printf("  -k <bytes>     : unknown key bytes to search (default 5 --> 40 bit, max %d)\n", SEARCH_MAX_UNKNOWN_SIZE);
+	printf("  -P <hex>       : known key prefix (e.g. an IV)\n");
+	printf("  -t <threads>   : worker threads (default: all cores)\n");
+	printf("  -C <file>      : checkpoint file (resumed if it exists)\n");
+	printf("  -a             : search the whole keyspace instead of stopping at the first key\n");
+	printf("  -h             : print this message\n");
+}
+
+int parse_hex(const char* hex, vector<uint8_t>& out) {
+	size_t len = strlen(hex);
+	if (len % 2 != 0)
+		return 1;
+	out.clear();
+	for (size_t i = 0; i < len; i += 2) {
+		char byte[3] = { hex[i], hex[i + 1], 0 };
+		char* end = NULL;
+		out.push_back((uint8_t) strtoul(byte, &end, 16));
+		if (*end != 0)
+			return 1;
+	}
+	return 0;
+}
+
+static void print_key(const char* label, uint8_t* key, uint32_t key_size) {
+	printf("%s0x", label);
+	for (uint32_t n = 0; n < key_size; n++)
+		printf("%02x", static_cast<int>(key[n]));
+	printf("\n");
+}
+
+static void search_worker(search_job* job, unsigned worker) {
+	uint8_t array_s[N];
+	uint8_t key[SEARCH_MAX_KEY_SIZE];
+	uint32_t key_size = job->prefix_size + job->unknown_size;
+	ksa_prefix_state prefix_state;
+	uint64_t block_count = (job->keyspace + SEARCH_BLOCK_KEYS - 1) / SEARCH_BLOCK_KEYS;
+	std::atomic<uint64_t>& slot = (*job->in_progress)[worker];
+
+	memcpy(key, job->prefix, job->prefix_size);
+	ksa_prefix_init(&prefix_state, key_size);
+
+	while (!job->stop) {
+		// Publish the block before taking it, the checkpoint watermark must never pass it
+		slot = job->next_block.load();
+		uint64_t block = job->next_block++;
+		slot = block;
+		if (block >= block_count)
+			break;
+
+		uint64_t first = block * SEARCH_BLOCK_KEYS;
+		uint64_t last = first + SEARCH_BLOCK_KEYS;
+		if (last > job->keyspace)
+			last = job->keyspace;
+
+		for (uint64_t candidate = first; candidate < last; candidate++) {
+			for (uint32_t b = 0; b < job->unknown_size; b++)
+				key[job->prefix_size + b] = (uint8_t) (candidate >> (8 * (job->unknown_size - 1 - b)));
+
+			ksa_prefix(&prefix_state, array_s, key);
+			if (prga_compare(array_s, job->keystream, job->keystream_size) != job->keystream_size)
+				continue;
+
+			std::lock_guard<std::mutex> guard(job->found_lock);
+			job->found.push_back(vector<uint8_t>(key, key + key_size));
+			print_key("[+] Key found: ", key, key_size);
+			fflush(stdout);
+			if (!job->find_all)
+				job->stop = true;
+		}
+		job->keys_done += last - first;
+	}
+	slot = UINT64_MAX;
+}
+
+// Every block below the returned one has been searched completely
+static uint64_t watermark(search_job* job) {
+	uint64_t low = job->next_block;
+	for (auto& slot : *job->in_progress) {
+		uint64_t block = slot;
+		if (block < low)
+			low = block;
+	}
+	return low;
+}
+
+static int save_checkpoint(const char* path, search_job* job, uint64_t block) {
+	string temporary = string(path) + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "w");
+	if (file == NULL) {
+		printf("[!] Could not write the checkpoint %s!\n", temporary.c_str());
+		return 1;
+	}
+	fprintf(file, "%u %u %u %llu\n", job->prefix_size, job->unknown_size, job->keystream_size, (unsigned long long) block);
+	for (uint32_t n = 0; n < job->prefix_size; n++)
+		fprintf(file, "%02x", job->prefix[n]);
+	fprintf(file, "\n");
+	for (uint32_t n = 0; n < job->keystream_size; n++)
+		fprintf(file, "%02x", job->keystream[n]);
+	fprintf(file, "\n");
+	fclose(file);
+	return rename(temporary.c_str(), path) == 0 ? 0 : 1;
+}
+
+// Returns the first block to search (0 without a matching checkpoint)
+static uint64_t load_checkpoint(const char* path, search_job* job) {
+	unsigned prefix_size = 0;
+	unsigned unknown_size = 0;
+	unsigned keystream_size = 0;
+	unsigned long long block = 0;
+	char prefix_hex[2 * SEARCH_MAX_KEY_SIZE + 2] = { 0 };
+	char keystream_hex[2 * SEARCH_MAX_KEYSTREAM_SIZE + 2] = { 0 };
+	char prefix_format[16];
+	char keystream_format[16];
+	vector<uint8_t> prefix;
+	vector<uint8_t> keystream;
+
+	// The field widths follow the buffers (one byte for the terminating NUL)
+	snprintf(prefix_format, sizeof(prefix_format), "%%%zus ", sizeof(prefix_hex) - 1);
+	snprintf(keystream_format, sizeof(keystream_format), "%%%zus", sizeof(keystream_hex) - 1);
+
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+		return 0;
+	int fields = fscanf(file, "%u %u %u %llu ", &prefix_size, &unknown_size, &keystream_size, &block);
+	if (fields == 4 && prefix_size > 0)
+		fields += fscanf(file, prefix_format, prefix_hex);
+	else
+		fields += 1;
+	fields += fscanf(file, keystream_format, keystream_hex);
+	fclose(file);
+
+	if (fields != 6 || parse_hex(prefix_hex, prefix) != 0 || parse_hex(keystream_hex, keystream) != 0 ||
+		prefix_size != job->prefix_size || unknown_size != job->unknown_size || keystream_size != job->keystream_size ||
+		prefix.size() != prefix_size || keystream.size() != keystream_size ||
+		memcmp(prefix.data(), job->prefix, prefix_size) != 0 || memcmp(keystream.data(), job->keystream, keystream_size) != 0) {
+		printf("[!] The checkpoint %s does not match the parameters, starting from scratch!\n", path);
+		return 0;
+	}
+	return block;
+}
+
+static int run_search(search_job* job, unsigned threads, const char* checkpoint_path, bool quiet) {
+	uint64_t block_count = (job->keyspace + SEARCH_BLOCK_KEYS - 1) / SEARCH_BLOCK_KEYS;
+	uint64_t first_block = 0;
+	vector<std::atomic<uint64_t>> in_progress(threads);
+	vector<std::thread> workers;
+
+	if (checkpoint_path != NULL) {
+		first_block = load_checkpoint(checkpoint_path, job);
+		if (first_block > 0)
+			printf("[*] Resuming from %s at candidate %llu\n", checkpoint_path, (unsigned long long) (first_block * SEARCH_BLOCK_KEYS));
+	}
+
+	job->next_block = first_block;
+	job->keys_done = 0;
+	job->stop = false;
+	job->in_progress = &in_progress;
+	for (auto& slot : in_progress)
+		slot = first_block;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point last_checkpoint = begin;
+	for (unsigned t = 0; t < threads; t++)
+		workers.push_back(std::thread(search_worker, job, t));
+
+	// Progress report / checkpoints
+	for (;;) {
+		bool running = false;
+		for (auto& slot : in_progress)
+			running |= (slot != UINT64_MAX);
+		if (!running)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (std::chrono::duration_cast<std::chrono::seconds>(now - last_checkpoint).count() >= SEARCH_CHECKPOINT_SECONDS) {
+			double seconds = std::chrono::duration_cast<std::chrono::microseconds>(now - begin).count() / 1e6;
+			uint64_t done = watermark(job);
+			if (!quiet) {
+				printf("[*] %.2f%% of the keyspace, %.0f keys/s\n", 100.0 * (done < block_count ? done : block_count) / block_count, job->keys_done / seconds);
+				fflush(stdout);
+			}
+			if (checkpoint_path != NULL)
+				save_checkpoint(checkpoint_path, job, done);
+			last_checkpoint = now;
+		}
+	}
+	for (auto& w : workers)
+		w.join();
+
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1e6;
+	printf("[*] Searched %llu keys in %.2f seconds (%.0f keys/s, %u threads)\n", (unsigned long long) job->keys_done.load(), seconds, job->keys_done / seconds, threads);
+
+	if (checkpoint_path != NULL)
+		save_checkpoint(checkpoint_path, job, job->stop ? watermark(job) : block_count);
+	return 0;
+}
+
+static int self_test(unsigned threads) {
+	int error = 0;
+
+	// Key ae6c3c4188 --> prefix ae6c3c is known, 4188 gets searched
+	uint8_t key[5] = { 0xae, 0x6c, 0x3c, 0x41, 0x88 };
+	// 3ae280d0d5cd70d8e0f81300dc9031a2
+	uint8_t plaintext[16] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2
+	};
+	uint8_t ciphertext[16] = { 0 };
+	rc4(5, 16, key, plaintext, ciphertext);
+
+	search_job job;
+	memcpy(job.prefix, key, 3);
+	job.prefix_size = 3;
+	job.unknown_size = 2;
+	job.keystream_size = 16;
+	for (int n = 0; n < 16; n++)
+		job.keystream[n] = plaintext[n] ^ ciphertext[n];
+	job.keyspace = 1ULL << 16;
+	job.find_all = true;
+
+	error += run_search(&job, threads, NULL, true);
+	if (job.found.size() != 1 || memcmp(job.found[0].data(), key, 5) != 0)
+		error += 1;
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	return error;
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	unsigned threads = std::thread::hardware_concurrency();
+	const char* checkpoint_path = NULL;
+	vector<uint8_t> plaintext;
+	vector<uint8_t> ciphertext;
+	vector<uint8_t> prefix;
+	search_job job;
+
+	job.unknown_size = 5;
+	job.find_all = false;
+	if (threads == 0)
+		threads = 1;
+
+	if (argc == 1)
+		return self_test(threads) == 0 ? 0 : 1;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-p") == 0) && (i < (argc - 1))) { if (parse_hex(argv[++i], plaintext) != 0) { print_help(); return 1; } }
+		else if ((strcmp(argv[i], "-c") == 0) && (i < (argc - 1))) { if (parse_hex(argv[++i], ciphertext) != 0) { print_help(); return 1; } }
+		else if ((strcmp(argv[i], "-P") == 0) && (i < (argc - 1))) { if (parse_hex(argv[++i], prefix) != 0) { print_help(); return 1; } }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { job.unknown_size = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-t") == 0) && (i < (argc - 1))) { threads = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-C") == 0) && (i < (argc - 1))) { checkpoint_path = argv[++i]; }
+		else if (strcmp(argv[i], "-a") == 0) { job.find_all = true; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	// Input Validation
+	if (plaintext.size() == 0 || plaintext.size() != ciphertext.size() || plaintext.size() > SEARCH_MAX_KEYSTREAM_SIZE ||
+		job.unknown_size == 0 || job.unknown_size > SEARCH_MAX_UNKNOWN_SIZE ||
+		prefix.size() + job.unknown_size > SEARCH_MAX_KEY_SIZE || threads == 0) {
+		print_help();
+		return 1;
+	}
+	if (plaintext.size() < job.unknown_size + 2)
+		printf("[!] Only %u known byte for a %u byte key --> expect false positives!\n", (unsigned) plaintext.size(), job.unknown_size);
+
+	memcpy(job.prefix, prefix.data(), prefix.size());
+	job.prefix_size = prefix.size();
+	job.keystream_size = plaintext.size();
+	for (size_t n = 0; n < plaintext.size(); n++)
+		job.keystream[n] = plaintext[n] ^ ciphertext[n];
+	job.keyspace = 1ULL << (8 * job.unknown_size);
+
+	if (run_search(&job, threads, checkpoint_path, false) != 0)
+		return 1;
+	if (job.found.empty()) {
+		printf("[!] No key found!\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __RC4_TIMER_H__
+#define __RC4_TIMER_H__
+
+#include <chrono>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RC4_TIMER_SOURCE "tsc"
+#else
+#define RC4_TIMER_SOURCE "steady_clock_ns"
+#endif
+
+// Low overhead timestamps for the benchmarks: the TSC on x86 (constant rate,
+// not core cycles under turbo), steady_clock nanoseconds elsewhere
+static inline uint64_t rc4_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Ticks per nanosecond, measured against steady_clock over 100 ms
+static inline double rc4_ticks_per_ns() {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	uint64_t first = rc4_ticks();
+	while (std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(100))
+		;
+	uint64_t last = rc4_ticks();
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	return (double) (last - first) / std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __RC4_TRACE_H__
+#define __RC4_TRACE_H__
+
+/*
+USDT (user level statically defined tracing) probes, provider "rc4"
+
+With <sys/sdt.h> (systemtap-sdt-dev) the probes use DTRACE_PROBEn. Without
+it an x86-64 build emits the same .note.stapsdt records directly, other
+targets (or -DRC4_NO_TRACE) compile the probes away. A probe site is a
+single nop while no tracer is attached, the arguments are passed as 8 byte
+values.
+
+	bpftrace -e 'usdt:./rc4:rc4:prga_entry { @size = hist(arg1); }'
+	bpftrace -e 'usdt:./rc4:rc4:ksa_entry { @rekeys = count(); } interval:s:1 { print(@rekeys); clear(@rekeys); }'
+	readelf -n ./rc4 (lists all probes)
+*/
+
+#include <stdint.h>
+
+#if defined(RC4_NO_TRACE)
+
+#define RC4_TRACE0(name)
+#define RC4_TRACE1(name, a)
+#define RC4_TRACE2(name, a, b)
+
+#elif defined(__has_include) && __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+#define RC4_TRACE0(name) DTRACE_PROBE(rc4, name)
+#define RC4_TRACE1(name, a) DTRACE_PROBE1(rc4, name, (uint64_t) (a))
+#define RC4_TRACE2(name, a, b) DTRACE_PROBE2(rc4, name, (uint64_t) (a), (uint64_t) (b))
+
+#elif defined(__x86_64__) && defined(__GNUC__)
+
+// Note layout as defined by systemtap: probe address, base address,
+// semaphore (none), provider, name and the argument format string
+#define RC4_SDT_ASM(name, args) \
+	"990: nop\n" \
+	".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+	".balign 4\n" \
+	".4byte 992f-991f, 994f-993f, 3\n" \
+	"991: .asciz \"stapsdt\"\n" \
+	"992: .balign 4\n" \
+	"993: .8byte 990b\n" \
+	".8byte _.stapsdt.base\n" \
+	".8byte 0\n" \
+	".asciz \"rc4\"\n" \
+	".asciz \"" #name "\"\n" \
+	".asciz \"" args "\"\n" \
+	"994: .balign 4\n" \
+	".popsection\n" \
+	".ifndef _.stapsdt.base\n" \
+	".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+	".weak _.stapsdt.base\n" \
+	".hidden _.stapsdt.base\n" \
+	"_.stapsdt.base: .space 1\n" \
+	".size _.stapsdt.base, 1\n" \
+	".popsection\n" \
+	".endif\n"
+
+#define RC4_TRACE0(name) __asm__ __volatile__ (RC4_SDT_ASM(name, ""))
+#define RC4_TRACE1(name, a) __asm__ __volatile__ (RC4_SDT_ASM(name, "8@%[a0]") :: [a0] "nor" ((uint64_t) (a)))
+#define RC4_TRACE2(name, a, b) __asm__ __volatile__ (RC4_SDT_ASM(name, "8@%[a0] 8@%[a1]") :: [a0] "nor" ((uint64_t) (a)), [a1] "nor" ((uint64_t) (b)))
+
+#else
+
+#define RC4_TRACE0(name)
+#define RC4_TRACE1(name, a)
+#define RC4_TRACE2(name, a, b)
+
+#endif
+
+#endif
@@ -0,0 +1,150 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+RC4A test vectors and head-to-head speed test against the classic prga()
+
+The test vectors were generated with an independent Python implementation
+(S2 keyed with the first 256 keystream bytes of S1, see rc4a_ksa()).
+
+Compile with this command:
+	g++ -O2 -o rc4a rc4a.cpp rc4_engine.cpp && ./rc4a
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4.h"
+
+using namespace std;
+
+
+struct rc4a_vector {
+	const char* key;
+	const char* plaintext;
+	const char* ciphertext;
+};
+
+static const rc4a_vector vectors[] = {
+	{
+		"ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405",
+		"3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595",
+		"9b5eadf38ec91e651e8f62c2152dd4a62445a3e073e16841482034a94ec3a020"
+	},
+	{
+		"4b6579", // "Key"
+		"00000000000000000000000000000000",
+		"d4ec60217daf07d8e3fd0c46b51d8097"
+	},
+	{
+		"0102030405", // odd size --> half of the last round
+		"00000000000000000000000000000000000000000000000000000000000000",
+		"f50e84657ca24913c9df3a0b5aad5bd87ee374b5c0a648f1e040d70ed4cf95"
+	}
+};
+
+static int parse_hex(const char* hex, uint8_t* out) {
+	size_t len = strlen(hex);
+	for (size_t i = 0; i < len; i += 2) {
+		char byte[3] = { hex[i], hex[i + 1], 0 };
+		out[i / 2] = (uint8_t) strtoul(byte, NULL, 16);
+	}
+	return len / 2;
+}
+
+int main()
+{
+	int i = 0;
+	int error = 0;
+	uint8_t array_s1[N];
+	uint8_t array_s2[N];
+
+	for (const rc4a_vector& test_vector : vectors) {
+		uint8_t key[32];
+		uint8_t plaintext[64];
+		uint8_t known_ciphertext[64];
+		uint8_t ciphertext[64] = { 0 };
+		int key_size = parse_hex(test_vector.key, key);
+		int plaintext_size = parse_hex(test_vector.plaintext, plaintext);
+		parse_hex(test_vector.ciphertext, known_ciphertext);
+
+		rc4a_ksa(array_s1, array_s2, key, key_size);
+		rc4a_prga(array_s1, array_s2, plaintext, ciphertext, plaintext_size);
+
+		printf("[*] KEY:         0x%s\n", test_vector.key);
+		printf("[*] Ciphertext:  0x");
+		for (i = 0; i < plaintext_size; i++) {
+			printf("%02x", static_cast<int>(ciphertext[i]));
+			if (ciphertext[i] != known_ciphertext[i])
+				error += 1;
+		}
+		printf("\n");
+		printf("[*] Known Ciph.: 0x%s\n", test_vector.ciphertext);
+	}
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+
+	// Speed test
+	printf("\n");
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	printf("[*] ... SPEED TEST (RC4 vs RC4A) ...\n");
+	uint8_t key[32];
+	int key_size = parse_hex(vectors[0].key, key);
+	const uint32_t plaintext_size_speed_test = 1024 * 1000 * 50; // 50 Megabyte
+	uint8_t* plaintext_speed_test = (uint8_t*) malloc(plaintext_size_speed_test);
+	memset(plaintext_speed_test, 'a', (size_t) plaintext_size_speed_test);
+	uint8_t* ciphertext_test = (uint8_t*) malloc(plaintext_size_speed_test);
+	memset(ciphertext_test, 0, (size_t) plaintext_size_speed_test);
+
+	for (int round = 0; round < 3; round++) {
+		ksa(array_s1, key, key_size);
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		prga(array_s1, plaintext_speed_test, ciphertext_test, plaintext_size_speed_test);
+		std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+		rc4a_ksa(array_s1, array_s2, key, key_size);
+		std::chrono::steady_clock::time_point setup = std::chrono::steady_clock::now();
+		rc4a_prga(array_s1, array_s2, plaintext_speed_test, ciphertext_test, plaintext_size_speed_test);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		float rc4_s = std::chrono::duration_cast<std::chrono::microseconds>(middle - begin).count() / 1e6;
+		float rc4a_s = std::chrono::duration_cast<std::chrono::microseconds>(end - setup).count() / 1e6;
+		printf("[*] Round %d: prga() %.2f MB/s, rc4a_prga() %.2f MB/s (%.2fx)\n", round + 1,
+			(plaintext_size_speed_test / (1024 * 1000)) / rc4_s, (plaintext_size_speed_test / (1024 * 1000)) / rc4a_s, rc4_s / rc4a_s);
+	}
+	free(plaintext_speed_test);
+	free(ciphertext_test);
+
+	return error == 0 ? 0 : 1;
+}
@@ -0,0 +1,520 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Compile with this command:
+	g++ -O2 -pthread -o rc4d rc4d.cpp rc4d_client.cpp rc4_batch.cpp rc4_ring.cpp rc4_engine.cpp rc4_arena.cpp rc4_numa.cpp -lnuma && ./rc4d
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4d.h"
+#include "rc4_batch.h"
+#include "rc4_ring.h"
+#include "rc4_arena.h"
+#include "rc4_numa.h"
+
+using namespace std;
+
+#define RC4D_BATCH_MAX 64
+#define RC4D_MAX_FDS 16
+
+
+struct rc4d_client_stats {
+	pid_t pid;
+	std::chrono::steady_clock::time_point connected;
+	uint64_t requests;
+	uint64_t fd_requests;
+	uint64_t bytes;
+	uint64_t latency_ns_total;
+	uint64_t latency_ns_max;
+};
+
+struct rc4d_pending {
+	rc4_job job;
+	std::promise<void> done;
+};
+
+static const char* socket_path = RC4D_DEFAULT_SOCKET;
+static unsigned coalesce_us = 50;
+
+// One queue per NUMA node, jobs go to the node that owns their buffer
+struct rc4d_node_queue {
+	std::mutex lock;
+	std::condition_variable signal;
+	std::deque<rc4d_pending*> queue;
+	unsigned workers = 0;
+	uint64_t jobs = 0;
+	uint64_t bytes = 0;
+	uint64_t busy_ns = 0;
+	rc4_numa_pool payloads;     // inline request payloads, bound to the node
+};
+
+static vector<rc4d_node_queue> node_queues;
+
+static std::mutex stats_lock;
+static std::list<rc4d_client_stats> clients;    // open connections only
+static rc4d_client_stats closed_clients;        // aggregate of the disconnected ones
+static uint64_t closed_count = 0;
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  -s <path>    : socket path (default %s)\n", RC4D_DEFAULT_SOCKET);
+	printf("  -t <threads> : batch worker threads (default: all cores)\n");
+	printf("  -w <us>      : batch coalescing window in microseconds (default 50, 0 disables)\n");
+	printf("  -h           : print this message\n");
+}
+
+// Hands a job to the batch workers of the node (the one owning its buffer) and waits until it has been processed
+static void submit(rc4d_pending* pending, int node) {
+	std::future<void> done = pending->done.get_future();
+	if (node_queues[node].workers == 0)
+		node = 0;
+	rc4d_node_queue& target = node_queues[node];
+	{
+		std::lock_guard<std::mutex> guard(target.lock);
+		target.queue.push_back(pending);
+	}
+	target.signal.notify_one();
+	done.wait();
+}
+
+static void batch_worker(int node) {
+	vector<rc4d_pending*> batch;
+	vector<rc4_job> jobs;
+	rc4d_node_queue& source = node_queues[node];
+	std::deque<rc4d_pending*>& queue = source.queue;
+
+	if (rc4_numa_nodes() > 1)
+		rc4_numa_bind_thread(node);
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> guard(source.lock);
+			source.signal.wait(guard, [&] { return !queue.empty(); });
+
+			// Give concurrent clients a short window to fill the lanes
+			if (coalesce_us > 0 && queue.size() < RC4_BATCH_LANES) {
+				source.signal.wait_for(guard, std::chrono::microseconds(coalesce_us),
+					[&] { return queue.size() >= RC4_BATCH_LANES; });
+			}
+
+			batch.clear();
+			while (!queue.empty() && batch.size() < RC4D_BATCH_MAX) {
+				batch.push_back(queue.front());
+				queue.pop_front();
+			}
+		}
+		if (batch.empty())
+			continue;
+
+		jobs.clear();
+		uint64_t bytes = 0;
+		for (auto pending : batch) {
+			jobs.push_back(pending->job);
+			bytes += pending->job.size;
+		}
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		rc4_batch(jobs.data(), jobs.size());
+		uint64_t busy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+		{
+			std::lock_guard<std::mutex> guard(source.lock);
+			source.jobs += batch.size();
+			source.bytes += bytes;
+			source.busy_ns += busy_ns;
+		}
+		for (size_t n = 0; n < batch.size(); n++) {
+			batch[n]->job.status = jobs[n].status;
+			batch[n]->done.set_value();
+		}
+	}
+}
+
+static string format_stats() {
+	char line[256];
+	string text;
+	std::lock_guard<std::mutex> guard(stats_lock);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	snprintf(line, sizeof(line), "%-8s %-6s %10s %10s %14s %10s %10s %10s\n",
+		"pid", "state", "requests", "fd_req", "bytes", "MB/s", "avg_us", "max_us");
+	text += line;
+	for (auto& client : clients) {
+		double seconds = std::chrono::duration_cast<std::chrono::microseconds>(now - client.connected).count() / 1e6;
+		double avg_us = client.requests ? client.latency_ns_total / 1000.0 / client.requests : 0;
+		snprintf(line, sizeof(line), "%-8d %-6s %10lu %10lu %14lu %10.2f %10.2f %10.2f\n",
+			(int) client.pid, "open",
+			(unsigned long) client.requests, (unsigned long) client.fd_requests, (unsigned long) client.bytes,
+			seconds > 0 ? client.bytes / (1024.0 * 1000) / seconds : 0, avg_us, client.latency_ns_max / 1000.0);
+		text += line;
+	}
+	if (closed_count > 0) {
+		double avg_us = closed_clients.requests ? closed_clients.latency_ns_total / 1000.0 / closed_clients.requests : 0;
+		snprintf(line, sizeof(line), "%-8s %-6lu %10lu %10lu %14lu %10s %10.2f %10.2f\n",
+			"closed", (unsigned long) closed_count,
+			(unsigned long) closed_clients.requests, (unsigned long) closed_clients.fd_requests, (unsigned long) closed_clients.bytes,
+			"-", avg_us, closed_clients.latency_ns_max / 1000.0);
+		text += line;
+	}
+
+	// Per node batch throughput (bytes per busy worker second)
+	snprintf(line, sizeof(line), "\n%-8s %8s %10s %14s %10s\n", "node", "workers", "jobs", "bytes", "MB/s");
+	text += line;
+	for (size_t node = 0; node < node_queues.size(); node++) {
+		rc4d_node_queue& queue = node_queues[node];
+		std::lock_guard<std::mutex> queue_guard(queue.lock);
+		snprintf(line, sizeof(line), "%-8zu %8u %10lu %14lu %10.2f\n", node, queue.workers, (unsigned long) queue.jobs,
+			(unsigned long) queue.bytes, queue.busy_ns ? queue.bytes / (1024.0 * 1000) / (queue.busy_ns / 1e9) : 0);
+		text += line;
+	}
+	return text;
+}
+
+// Receives the request header and an optional SCM_RIGHTS file descriptor (extra descriptors get closed)
+static int receive_request(int sock, rc4d_request* request, int* fd) {
+	struct msghdr message;
+	struct iovec vector;
+	char control[CMSG_SPACE(sizeof(int) * RC4D_MAX_FDS)];
+
+	// A descriptor left over from the previous request is not needed anymore
+	if (*fd >= 0)
+		close(*fd);
+	*fd = -1;
+	memset(&message, 0, sizeof(message));
+	vector.iov_base = request;
+	vector.iov_len = sizeof(*request);
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	ssize_t received = recvmsg(sock, &message, MSG_CMSG_CLOEXEC);
+	if (received <= 0)
+		return 1;
+
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (size_t n = 0; n < count; n++) {
+			int received_fd;
+			memcpy(&received_fd, CMSG_DATA(cmsg) + n * sizeof(int), sizeof(int));
+			if (*fd < 0)
+				*fd = received_fd;
+			else
+				close(received_fd);
+		}
+	}
+
+	if ((size_t) received < sizeof(*request))
+		return rc4d_recv_all(sock, (uint8_t*) request + received, sizeof(*request) - received);
+	return 0;
+}
+
+static int send_response(int sock, int32_t status, uint64_t size, const void* payload) {
+	rc4d_response response;
+	response.magic = RC4D_MAGIC;
+	response.status = status;
+	response.size = size;
+	if (rc4d_send_all(sock, &response, sizeof(response)) != 0)
+		return 1;
+	if (payload != NULL && size > 0)
+		return rc4d_send_all(sock, payload, size);
+	return 0;
+}
+
+// Encrypts [offset, offset + size) of the client's file descriptor in place
+static int process_fd(rc4d_pending* pending, rc4d_request* request, int fd) {
+	long page_size = sysconf(_SC_PAGESIZE);
+	uint64_t map_offset = request->offset & ~((uint64_t) page_size - 1);
+	uint64_t map_size = request->offset - map_offset + request->size;
+	struct stat info;
+
+	if (request->size == 0)
+		return 0;
+
+	// A range past EOF (or a client shrinking the file during the request) would SIGBUS the daemon.
+	// Seals first: only once the file cannot shrink anymore is its size worth checking.
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+		printf("[!] Client file descriptor is not sealed against shrinking (F_SEAL_SHRINK)!\n");
+		return 1;
+	}
+	if (request->offset + request->size < request->offset || fstat(fd, &info) != 0
+		|| request->offset + request->size > (uint64_t) info.st_size) {
+		printf("[!] Client file descriptor range is out of bounds!\n");
+		return 1;
+	}
+
+	void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, map_offset);
+	if (map == MAP_FAILED) {
+		printf("[!] Could not mmap the client file descriptor!\n");
+		return 1;
+	}
+
+	uint8_t* data = (uint8_t*) map + (request->offset - map_offset);
+	pending->job.plaintext = (request->op == RC4D_OP_KEYSTREAM) ? NULL : data;
+	pending->job.ciphertext = data;
+	submit(pending, rc4_numa_node_of(data));
+
+	munmap(map, map_size);
+	return pending->job.status;
+}
+
+// Each connection is homed on a node: the thread runs there and its inline payloads come from the node's pool
+static void client_thread(int sock, rc4d_client_stats* stats, int node) {
+	rc4d_request request;
+	vector<std::thread> ring_workers;
+	std::atomic<bool> ring_stop(false);
+	int fd = -1;
+	rc4_numa_pool* payloads = &node_queues[node].payloads;
+
+	if (rc4_numa_nodes() > 1)
+		rc4_numa_bind_thread(node);
+
+	while (receive_request(sock, &request, &fd) == 0) {
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		int status = 0;
+
+		if (request.magic != RC4D_MAGIC) {
+			printf("[!] Invalid request from pid %d, closing the connection!\n", (int) stats->pid);
+			break;
+		}
+
+		if (request.op == RC4D_OP_STATS) {
+			string text = format_stats();
+			if (fd >= 0) {
+				close(fd);
+				fd = -1;
+			}
+			if (send_response(sock, 0, text.size(), text.data()) != 0)
+				break;
+			continue;
+		}
+
+		if (request.op == RC4D_OP_RING) {
+			rc4_ring* ring = new rc4_ring();
+			int status = (fd < 0) ? 1 : rc4_ring_attach(ring, fd);
+			if (status == 0) {
+				// The ring owns the file descriptor from now on
+				fd = -1;
+				ring_workers.push_back(std::thread([ring, &ring_stop]() {
+					rc4_ring_serve(ring, &ring_stop);
+					rc4_ring_detach(ring);
+					delete ring;
+				}));
+			}
+			else {
+				delete ring;
+			}
+			if (send_response(sock, status, 0, NULL) != 0)
+				break;
+			if (fd >= 0) {
+				close(fd);
+				fd = -1;
+			}
+			continue;
+		}
+
+		rc4d_pending pending;
+		pending.job.key = request.key;
+		pending.job.key_size = request.key_size;
+		pending.job.size = request.size;
+		pending.job.status = 0;
+
+		if (request.op != RC4D_OP_ENCRYPT && request.op != RC4D_OP_DECRYPT && request.op != RC4D_OP_KEYSTREAM) {
+			// The payload framing is unknown --> answer and drop the connection
+			send_response(sock, 1, 0, NULL);
+			break;
+		}
+		else if (request.flags & RC4D_FLAG_FD) {
+			status = (fd < 0) ? 1 : process_fd(&pending, &request, fd);
+			if (send_response(sock, status, request.size, NULL) != 0)
+				break;
+		}
+		else {
+			if (request.size > RC4D_MAX_INLINE_SIZE) {
+				// The payload is not read --> answer and drop the connection
+				send_response(sock, 1, 0, NULL);
+				break;
+			}
+			// Per request payload from the home node's pool (huge page slabs, no malloc per request)
+			uint8_t* payload = (uint8_t*) rc4_numa_pool_alloc(payloads, request.size);
+			if (request.size > 0 && payload == NULL)
+				break;
+			if (request.op != RC4D_OP_KEYSTREAM && rc4d_recv_all(sock, payload, request.size) != 0) {
+				rc4_numa_pool_free(payloads, payload, request.size);
+				break;
+			}
+			pending.job.plaintext = (request.op == RC4D_OP_KEYSTREAM) ? NULL : payload;
+			pending.job.ciphertext = payload;
+			if (request.size > 0)
+				submit(&pending, node);
+			status = pending.job.status;
+			int sent = send_response(sock, status, status == 0 ? request.size : 0, status == 0 ? payload : NULL);
+			rc4_numa_pool_free(payloads, payload, request.size);
+			if (sent != 0)
+				break;
+		}
+
+		if (fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+
+		uint64_t latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+		std::lock_guard<std::mutex> guard(stats_lock);
+		stats->requests++;
+		stats->fd_requests += (request.flags & RC4D_FLAG_FD) ? 1 : 0;
+		stats->bytes += (status == 0) ? request.size : 0;
+		stats->latency_ns_total += latency_ns;
+		if (latency_ns > stats->latency_ns_max)
+			stats->latency_ns_max = latency_ns;
+	}
+
+	if (fd >= 0)
+		close(fd);
+	close(sock);
+
+	ring_stop = true;
+	for (auto& worker : ring_workers)
+		worker.join();
+
+	// Fold the client into the closed aggregate, the list only holds open connections
+	std::lock_guard<std::mutex> guard(stats_lock);
+	closed_count++;
+	closed_clients.requests += stats->requests;
+	closed_clients.fd_requests += stats->fd_requests;
+	closed_clients.bytes += stats->bytes;
+	closed_clients.latency_ns_total += stats->latency_ns_total;
+	if (stats->latency_ns_max > closed_clients.latency_ns_max)
+		closed_clients.latency_ns_max = stats->latency_ns_max;
+	clients.remove_if([stats](const rc4d_client_stats& client) { return &client == stats; });
+}
+
+static void shutdown_handler(int /*signum*/) {
+	unlink(socket_path);
+	_exit(0);
+}
+
+int main(int argc, char** argv)
+{
+	int i = 0;
+	unsigned threads = 0;
+	struct sockaddr_un address;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { socket_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-t") == 0) && (i < (argc - 1))) { threads = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-w") == 0) && (i < (argc - 1))) { coalesce_us = strtoul(argv[++i], NULL, 0); }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+	unlink(socket_path);
+	if (listener < 0 || bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+		printf("[!] Could not listen on %s!\n", socket_path);
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, shutdown_handler);
+	signal(SIGTERM, shutdown_handler);
+
+	// Workers are spread over the NUMA nodes in proportion to their CPUs
+	int nodes = rc4_numa_nodes();
+	node_queues = vector<rc4d_node_queue>(nodes);
+	vector<int> worker_nodes;
+	for (int node = 0; node < nodes; node++) {
+		for (int cpu = 0; cpu < rc4_numa_node_cpus(node); cpu++)
+			worker_nodes.push_back(node);
+	}
+	if (worker_nodes.empty())
+		worker_nodes.push_back(0);
+	for (int node = 0; node < nodes; node++)
+		rc4_numa_pool_init(&node_queues[node].payloads, node);
+	vector<int> client_nodes;
+	for (unsigned t = 0; t < threads; t++) {
+		int node = worker_nodes[(size_t) t * worker_nodes.size() / threads];
+		node_queues[node].workers++;
+		client_nodes.push_back(node);
+		std::thread(batch_worker, node).detach();
+	}
+	uint64_t connections = 0;
+
+	printf("[*] rc4d listening on %s (%u batch workers on %d NUMA nodes, %u us coalescing window)\n", socket_path, threads, nodes, coalesce_us);
+	fflush(stdout);
+
+	for (;;) {
+		int sock = accept(listener, NULL, NULL);
+		if (sock < 0)
+			continue;
+
+		struct ucred credentials;
+		socklen_t length = sizeof(credentials);
+		memset(&credentials, 0, sizeof(credentials));
+		getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &credentials, &length);
+
+		rc4d_client_stats* stats;
+		{
+			std::lock_guard<std::mutex> guard(stats_lock);
+			clients.push_back(rc4d_client_stats());
+			stats = &clients.back();
+			stats->pid = credentials.pid;
+			stats->connected = std::chrono::steady_clock::now();
+		}
+		// Connections are spread over the nodes in proportion to their batch workers
+		int node = client_nodes[connections++ % client_nodes.size()];
+		std::thread(client_thread, sock, stats, node).detach();
+	}
+	return 0;
+}
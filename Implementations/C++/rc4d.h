@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+rc4d - local RC4 daemon
+
+Protocol over a Unix domain stream socket (host byte order, local only):
+	client --> rc4d_request [+ inline payload of size byte]
+	rc4d   --> rc4d_response [+ inline result of size byte]
+
+Large payloads do not have to be copied through the socket: with
+RC4D_FLAG_FD the request carries a file descriptor (memfd) as SCM_RIGHTS
+ancillary data and rc4d encrypts [offset, offset + size) of it in place.
+The memfd has to be sealed with F_SEAL_SHRINK and the range has to lie
+within the file, otherwise the request fails.
+
+RC4D_OP_STATS returns a text table with the per-client statistics.
+
+RC4D_OP_RING hands a shared-memory ring (see rc4_ring.h) to the daemon, a
+dedicated worker serves it until the ring is shut down or the client
+disconnects.
+*/
+
+#ifndef __RC4D_H__
+#define __RC4D_H__
+
+#include <stdint.h>
+#include <string>
+
+#define RC4D_MAGIC 0x44344352 // "RC4D"
+#define RC4D_DEFAULT_SOCKET "/tmp/rc4d.sock"
+#define RC4D_MAX_INLINE_SIZE (16 * 1024 * 1024)
+#define RC4D_MAX_KEY_SIZE 32
+
+#define RC4D_OP_ENCRYPT 1
+#define RC4D_OP_DECRYPT 2
+#define RC4D_OP_KEYSTREAM 3
+#define RC4D_OP_STATS 4
+#define RC4D_OP_RING 5
+
+#define RC4D_FLAG_FD 1
+
+struct rc4d_request {
+	uint32_t magic;
+	uint16_t op;
+	uint16_t flags;
+	uint16_t key_size;
+	uint16_t reserved;
+	uint32_t reserved2;
+	uint64_t offset;        // only used with RC4D_FLAG_FD
+	uint64_t size;
+	uint8_t key[RC4D_MAX_KEY_SIZE];
+};
+
+struct rc4d_response {
+	uint32_t magic;
+	int32_t status;         // 0 on success
+	uint64_t size;
+};
+
+// Client API (returns 0 on success)
+int rc4d_connect(const char* path);
+int rc4d_crypt(int sock, uint16_t op, uint8_t* key, uint16_t key_size, uint8_t* in, uint8_t* out, uint64_t size);
+int rc4d_crypt_fd(int sock, uint16_t op, uint8_t* key, uint16_t key_size, int fd, uint64_t offset, uint64_t size);
+int rc4d_stats(int sock, std::string& stats);
+int rc4d_attach_ring(int sock, int ring_fd);
+
+// Shared socket helpers
+int rc4d_send_all(int sock, const void* data, uint64_t size);
+int rc4d_recv_all(int sock, void* data, uint64_t size);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstring>
+#include <vector>
+#include "rc4d.h"
+
+int rc4d_send_all(int sock, const void* data, uint64_t size) {
+	const uint8_t* p = (const uint8_t*) data;
+	while (size > 0) {
+		ssize_t sent = send(sock, p, size, MSG_NOSIGNAL);
+		if (sent <= 0)
+			return 1;
+		p += sent;
+		size -= sent;
+	}
+	return 0;
+}
+
+int rc4d_recv_all(int sock, void* data, uint64_t size) {
+	uint8_t* p = (uint8_t*) data;
+	while (size > 0) {
+		ssize_t received = recv(sock, p, size, 0);
+		if (received <= 0)
+			return 1;
+		p += received;
+		size -= received;
+	}
+	return 0;
+}
+
+int rc4d_connect(const char* path) {
+	struct sockaddr_un address;
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -1;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+	if (connect(sock, (struct sockaddr*) &address, sizeof(address)) != 0) {
+		printf("[!] Could not connect to %s!\n", path);
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+static int fill_request(rc4d_request* request, uint16_t op, uint8_t* key, uint16_t key_size, uint64_t size) {
+	memset(request, 0, sizeof(*request));
+	if (key_size == 0 || key_size > RC4D_MAX_KEY_SIZE) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+	request->magic = RC4D_MAGIC;
+	request->op = op;
+	request->key_size = key_size;
+	request->size = size;
+	memcpy(request->key, key, key_size);
+	return 0;
+}
+
+int rc4d_crypt(int sock, uint16_t op, uint8_t* key, uint16_t key_size, uint8_t* in, uint8_t* out, uint64_t size) {
+	rc4d_request request;
+	rc4d_response response;
+
+	if (size > RC4D_MAX_INLINE_SIZE) {
+		printf("[!] Payloads larger than %d byte have to be passed as file descriptor!\n", RC4D_MAX_INLINE_SIZE);
+		return 1;
+	}
+	if (fill_request(&request, op, key, key_size, size) != 0)
+		return 1;
+
+	if (rc4d_send_all(sock, &request, sizeof(request)) != 0)
+		return 1;
+	if (op != RC4D_OP_KEYSTREAM && rc4d_send_all(sock, in, size) != 0)
+		return 1;
+	if (rc4d_recv_all(sock, &response, sizeof(response)) != 0 || response.magic != RC4D_MAGIC)
+		return 1;
+	if (response.status != 0 || response.size != size)
+		return 1;
+	return rc4d_recv_all(sock, out, size);
+}
+
+static int send_request_fd(int sock, rc4d_request* request, int fd) {
+	rc4d_response response;
+	struct msghdr message;
+	struct iovec vector;
+	char control[CMSG_SPACE(sizeof(int))];
+
+	request->flags = RC4D_FLAG_FD;
+
+	// The file descriptor travels as SCM_RIGHTS next to the request header
+	memset(&message, 0, sizeof(message));
+	memset(control, 0, sizeof(control));
+	vector.iov_base = request;
+	vector.iov_len = sizeof(*request);
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	if (sendmsg(sock, &message, MSG_NOSIGNAL) != (ssize_t) sizeof(*request))
+		return 1;
+	if (rc4d_recv_all(sock, &response, sizeof(response)) != 0 || response.magic != RC4D_MAGIC)
+		return 1;
+	return response.status;
+}
+
+int rc4d_crypt_fd(int sock, uint16_t op, uint8_t* key, uint16_t key_size, int fd, uint64_t offset, uint64_t size) {
+	rc4d_request request;
+
+	if (fill_request(&request, op, key, key_size, size) != 0)
+		return 1;
+	request.offset = offset;
+	return send_request_fd(sock, &request, fd);
+}
+
+int rc4d_attach_ring(int sock, int ring_fd) {
+	rc4d_request request;
+
+	memset(&request, 0, sizeof(request));
+	request.magic = RC4D_MAGIC;
+	request.op = RC4D_OP_RING;
+	return send_request_fd(sock, &request, ring_fd);
+}
+
+int rc4d_stats(int sock, std::string& stats) {
+	rc4d_request request;
+	rc4d_response response;
+
+	memset(&request, 0, sizeof(request));
+	request.magic = RC4D_MAGIC;
+	request.op = RC4D_OP_STATS;
+
+	if (rc4d_send_all(sock, &request, sizeof(request)) != 0)
+		return 1;
+	if (rc4d_recv_all(sock, &response, sizeof(response)) != 0 || response.magic != RC4D_MAGIC || response.status != 0)
+		return 1;
+
+	std::vector<char> text(response.size);
+	if (rc4d_recv_all(sock, text.data(), text.size()) != 0)
+		return 1;
+	stats.assign(text.begin(), text.end());
+	return 0;
+}
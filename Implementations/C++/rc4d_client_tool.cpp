@@ -0,0 +1,194 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+Compile with this command:
+	g++ -O2 -pthread -o rc4d_client rc4d_client_tool.cpp rc4d_client.cpp rc4_engine.cpp && ./rc4d_client
+(rc4d has to be running)
+*/
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4d.h"
+#include "rc4.h"
+
+using namespace std;
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  -s <path>    : socket path (default %s)\n", RC4D_DEFAULT_SOCKET);
+	printf("  -t <threads> : concurrent client threads for the small record test (default 4)\n");
+	printf("  -n <count>   : small records per thread (default 10000)\n");
+	printf("  -S           : only print the daemon statistics\n");
+	printf("  -h           : print this message\n");
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t i = 0;
+	int error = 0;
+	const char* socket_path = RC4D_DEFAULT_SOCKET;
+	unsigned threads = 4;
+	unsigned records = 10000;
+	bool stats_only = false;
+
+	for (i = 1; i < (uint32_t) argc; i++) {
+		if ((strcmp(argv[i], "-s") == 0) && (i < (uint32_t) (argc - 1))) { socket_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-t") == 0) && (i < (uint32_t) (argc - 1))) { threads = strtoul(argv[++i], NULL, 0); }
+		else if ((strcmp(argv[i], "-n") == 0) && (i < (uint32_t) (argc - 1))) { records = strtoul(argv[++i], NULL, 0); }
+		else if (strcmp(argv[i], "-S") == 0) { stats_only = true; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	int sock = rc4d_connect(socket_path);
+	if (sock < 0)
+		return 1;
+
+	string stats;
+	if (stats_only) {
+		if (rc4d_stats(sock, stats) != 0)
+			return 1;
+		printf("%s", stats.c_str());
+		return 0;
+	}
+
+	const uint16_t key_size = 32;
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[key_size] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+
+	const uint32_t plaintext_size = 32;
+	// 3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595
+	uint8_t plaintext[plaintext_size] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2,
+			0xe0, 0xf8, 0x51, 0x2c, 0xb3, 0x5a, 0x75, 0x79,
+			0xfd, 0x79, 0x57, 0x5c, 0xf2, 0x87, 0xc5, 0x95
+	};
+
+	// 2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179
+	uint8_t known_ciphertext[plaintext_size] = {
+			0x22, 0x80, 0xc9, 0x67, 0x6c, 0x8f, 0x5c, 0x52,
+			0xab, 0xa8, 0xd4, 0x26, 0x11, 0xf8, 0x5e, 0x7c,
+			0xa9, 0x61, 0xa2, 0x11, 0x7d, 0x3c, 0xfc, 0x82,
+			0x36, 0xa6, 0x05, 0x1b, 0xbf, 0xc5, 0xf1, 0x79
+	};
+
+	uint8_t ciphertext[plaintext_size] = { 0 };
+	uint8_t keystream[plaintext_size] = { 0 };
+
+	// Inline encryption and keystream
+	error += rc4d_crypt(sock, RC4D_OP_ENCRYPT, key, key_size, plaintext, ciphertext, plaintext_size);
+	error += rc4d_crypt(sock, RC4D_OP_KEYSTREAM, key, key_size, NULL, keystream, plaintext_size);
+	printf("[*] Ciphertext:  0x");
+	for (i = 0; i < plaintext_size; i++) {
+		printf("%02x", static_cast<int>(ciphertext[i]));
+		if (ciphertext[i] != known_ciphertext[i] || (keystream[i] ^ plaintext[i]) != known_ciphertext[i])
+			error += 1;
+	}
+	printf("\n");
+
+	// Large payload as memfd --> encrypted in place by the daemon
+	const uint64_t plaintext_size_speed_test = 1024 * 1000 * 50; // 50 Megabyte
+	int fd = memfd_create("rc4d_payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0 || ftruncate(fd, plaintext_size_speed_test) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) != 0) {
+		printf("[!] Could not create the memfd!\n");
+		return 1;
+	}
+	uint8_t* payload = (uint8_t*) mmap(NULL, plaintext_size_speed_test, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	memset(payload, 'a', plaintext_size_speed_test);
+	uint8_t* expected = (uint8_t*) malloc(plaintext_size_speed_test);
+	rc4(key_size, plaintext_size_speed_test, key, payload, expected);
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	error += rc4d_crypt_fd(sock, RC4D_OP_ENCRYPT, key, key_size, fd, 0, plaintext_size_speed_test);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	if (memcmp(payload, expected, plaintext_size_speed_test) != 0)
+		error += 1;
+	float time_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0;
+	printf("[*] memfd: encrypted %d MB in %.2f seconds (%.2f MB/s)\n", (int) (plaintext_size_speed_test / (1024 * 1000)), time_ms / 1000, (plaintext_size_speed_test / (1024.0 * 1000)) / (time_ms / 1000));
+	munmap(payload, plaintext_size_speed_test);
+	close(fd);
+	free(expected);
+
+	// Concurrent small records (gets coalesced into batches by the daemon)
+	std::atomic<int> record_errors(0);
+	vector<std::thread> workers;
+	begin = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&, t]() {
+			int client = rc4d_connect(socket_path);
+			uint8_t record[64];
+			uint8_t result[64];
+			if (client < 0) {
+				record_errors++;
+				return;
+			}
+			memset(record, t, sizeof(record));
+			for (unsigned n = 0; n < records; n++) {
+				if (rc4d_crypt(client, RC4D_OP_ENCRYPT, key, key_size, record, result, sizeof(record)) != 0)
+					record_errors++;
+			}
+			close(client);
+		}));
+	}
+	for (auto& w : workers)
+		w.join();
+	end = std::chrono::steady_clock::now();
+	error += record_errors;
+	time_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0;
+	printf("[*] %u threads: %u records of 64 byte in %.2f seconds (%.0f records/s)\n", threads, threads * records, time_ms / 1000, threads * records / (time_ms / 1000));
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	}
+
+	if (rc4d_stats(sock, stats) == 0)
+		printf("%s", stats.c_str());
+	close(sock);
+	return error == 0 ? 0 : 1;
+}
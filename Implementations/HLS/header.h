@@ -30,7 +30,12 @@ SOFTWARE.
 #include <ap_int.h>
 #include <hls_stream.h>
 
+// State size, reduced-state research builds can override it (e.g. -DN=16 for
+// C simulation), all index arithmetic is % N which HLS maps to a bit select
+// for powers of two
+#ifndef N
 #define N 256   // 2^8
+#endif
 
 using namespace std;
 using namespace hls;
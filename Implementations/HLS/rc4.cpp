@@ -54,7 +54,7 @@ void rc4(
 	}
 
 	// KSA - Key Scheduling Algorithm
-	ksa(array_s, key, plaintext_size_in);
+	ksa(array_s, key, key_size_in);
 
 	// PRGA - Pseudo Random Generation Algorithm
 	prga(array_s, plaintext_in, ciphertext_out, plaintext_size_in);
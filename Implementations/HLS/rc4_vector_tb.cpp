@@ -0,0 +1,111 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+File driven C simulation testbench (used by ../rc4_crossbench.py)
+
+Streams an arbitrary key / plaintext through the rc4() top function and
+writes the ciphertext, so the HLS source can be checked against the C++
+reference with multi-MB vectors. Only the rc4() call is timed; KSA and PRGA
+are one top function here, so there is no separate setup time.
+
+C simulation outside of Vivado HLS:
+	g++ -O2 -I$XILINX_HLS/include -o rc4_vector_tb rc4.cpp rc4_vector_tb.cpp
+	./rc4_vector_tb key.bin plaintext.bin ciphertext.bin
+Inside Vivado HLS: add rc4_vector_tb.cpp as testbench and run
+	csim_design -argv "key.bin plaintext.bin ciphertext.bin"
+*/
+
+#include <chrono>
+#include <vector>
+#include "header.h"
+
+static int read_file(const char* path, vector<uint8_t>& data) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return 1;
+	int byte = 0;
+	data.clear();
+	while ((byte = fgetc(file)) != EOF)
+		data.push_back((uint8_t) byte);
+	fclose(file);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	// Variable Definition
+	vector<uint8_t> key;
+	vector<uint8_t> plaintext;
+
+	if (argc != 4) {
+		printf("[*] Application usage:\n");
+		printf("  rc4_vector_tb <key file> <plaintext file> <ciphertext file>\n");
+		return 1;
+	}
+	if (read_file(argv[1], key) != 0 || read_file(argv[2], plaintext) != 0) {
+		printf("[!] Could not read the key / plaintext file!\n");
+		return 1;
+	}
+	if (key.size() == 0 || key.size() > 32) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+
+	stream<uint8_t> key_in;
+	stream<uint8_t> plaintext_in;
+	stream<uint8_t> ciphertext_out;
+
+	// Filling the Streams
+	for (size_t n = 0; n < key.size(); n++)
+		key_in << key[n];
+	for (size_t n = 0; n < plaintext.size(); n++)
+		plaintext_in << plaintext[n];
+
+	// RC4 Algorithm
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	rc4(
+		key.size(),
+		plaintext.size(),
+		key_in,
+		plaintext_in,
+		ciphertext_out);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+	// Ciphertext extraction
+	FILE* file = fopen(argv[3], "wb");
+	if (file == NULL) {
+		printf("[!] Could not write the ciphertext file!\n");
+		return 1;
+	}
+	uint8_t ciphertext_byte = 0;
+	for (size_t n = 0; n < plaintext.size(); n++) {
+		ciphertext_out >> ciphertext_byte;
+		fputc(ciphertext_byte, file);
+	}
+	fclose(file);
+
+	printf("[*] Vector: %zu byte in %.6f seconds\n", plaintext.size(), std::chrono::duration<double>(end - begin).count());
+	return 0;
+}
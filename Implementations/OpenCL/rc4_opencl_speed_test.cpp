@@ -1,6 +1,7 @@
 /*
  *	INITIAL SOURCE: https://github.com/gcielniak/OpenCL-Tutorials
  *	COMPILATION: g++ -lOpenCL -o rc4_opencl_speed_test rc4_opencl_speed_test.cpp
+ *	VECTOR MODE: ./rc4_opencl_speed_test -k key.bin -i plaintext.bin -o ciphertext.bin (see ../rc4_crossbench.py)
  */
 
 
@@ -8,6 +9,7 @@
 #include <vector>
 #include <chrono>
 #include "Utils.h"
+#include "../C++/rc4_energy.h"
 
 
 void print_help() {
@@ -16,9 +18,20 @@ void print_help() {
 	std::cerr << "  -p : select platform " << std::endl;
 	std::cerr << "  -d : select device" << std::endl;
 	std::cerr << "  -l : list all platforms and devices" << std::endl;
+	std::cerr << "  -k : vector mode, binary key file (1 - 32 byte)" << std::endl;
+	std::cerr << "  -i : vector mode, binary plaintext file" << std::endl;
+	std::cerr << "  -o : vector mode, binary ciphertext output file" << std::endl;
 	std::cerr << "  -h : print this message" << std::endl;
 }
 
+bool read_file(const char* path, std::vector<uint8_t>& data) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
 int main(int argc, char **argv) {
 	int i = 0;
 	int error = 0;
@@ -26,17 +39,28 @@ int main(int argc, char **argv) {
 
 	int platform_id = 0;
 	int device_id = 0;
+	const char* key_path = NULL;
+	const char* plaintext_path = NULL;
+	const char* ciphertext_path = NULL;
 
 	for (i = 1; i < argc; i++)	{
 		if ((strcmp(argv[i], "-p") == 0) && (i < (argc - 1))) { platform_id = atoi(argv[++i]); }
 		else if ((strcmp(argv[i], "-d") == 0) && (i < (argc - 1))) { device_id = atoi(argv[++i]); }
 		else if (strcmp(argv[i], "-l") == 0) { std::cout << ListPlatformsDevices() << std::endl; }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-i") == 0) && (i < (argc - 1))) { plaintext_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-o") == 0) && (i < (argc - 1))) { ciphertext_path = argv[++i]; }
 		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
 	}
 
+	bool vector_mode = (key_path != NULL || plaintext_path != NULL || ciphertext_path != NULL);
+	if (vector_mode && (key_path == NULL || plaintext_path == NULL || ciphertext_path == NULL)) {
+		std::cerr << "[!] Vector mode needs -k, -i and -o!" << std::endl;
+		return 1;
+	}
+
 	try {
-		const uint16_t key_size = 32;
-		const size_t key_size_bytes = key_size * sizeof(uint8_t);
+		uint16_t key_size = 32;
 		// KEY: ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
 		std::vector<uint8_t> key = {
 				0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
@@ -45,10 +69,20 @@ int main(int argc, char **argv) {
 				0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
 		};
 
-		const uint32_t plaintext_size = 1024 * 1000 * 10; // 10 Megabyte
-		const size_t plaintext_size_bytes = plaintext_size * sizeof(uint8_t);
+		uint32_t plaintext_size = 1024 * 1000 * 10; // 10 Megabyte
 		std::vector<uint8_t> plaintext(plaintext_size, 'a');
 
+		if (vector_mode) {
+			if (!read_file(key_path, key) || !read_file(plaintext_path, plaintext) || key.size() == 0 || key.size() > 32 || plaintext.size() == 0) {
+				std::cerr << "[!] The vector needs a 1 - 32 byte key and a non-empty plaintext!" << std::endl;
+				return 1;
+			}
+			key_size = key.size();
+			plaintext_size = plaintext.size();
+		}
+		const size_t key_size_bytes = key_size * sizeof(uint8_t);
+		const size_t plaintext_size_bytes = plaintext_size * sizeof(uint8_t);
+
 		std::vector<uint8_t> ciphertext(plaintext_size);
 
 		// LAST 32 BYTE OF THE KNOWN CIPHERTEXT: 0d7e9b0d51a432b89e7438d498ac83a5236c521ecbec5a8af66182426a31566c
@@ -59,7 +93,10 @@ int main(int argc, char **argv) {
 				0xf6, 0x61, 0x82, 0x42, 0x6a, 0x31, 0x56, 0x6c
 		};
 
-		// START TIMER
+		// START TIMER (and the RAPL energy counters, if readable)
+		rc4_energy energy;
+		rc4_energy_open(&energy);
+		rc4_energy_start(&energy);
 		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
 		cl::Context context = GetContext(platform_id, device_id);
@@ -79,6 +116,8 @@ int main(int argc, char **argv) {
 			std::cout << "[!] Build Log:\t " << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(context.getInfo<CL_CONTEXT_DEVICES>()[0]) << std::endl;
 			throw err;
 		}
+		// Context creation and the kernel build are setup, not encryption
+		std::chrono::steady_clock::time_point setup = std::chrono::steady_clock::now();
 
 
 		cl::Buffer buffer_key(context, CL_MEM_READ_WRITE, key_size_bytes);
@@ -102,8 +141,21 @@ int main(int argc, char **argv) {
 
 		// STOP TIMER
 		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		rc4_energy_stop(&energy);
 		float time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
 
+		if (vector_mode) {
+			std::ofstream file(ciphertext_path, std::ios::binary);
+			file.write((const char*) &ciphertext[0], plaintext_size_bytes);
+			if (!file) {
+				std::cerr << "[!] Could not write the ciphertext file!" << std::endl;
+				return 1;
+			}
+			printf("[*] Vector: %lu byte in %.6f seconds (setup %.6f seconds)\n", (unsigned long) plaintext_size_bytes,
+				std::chrono::duration<double>(end - setup).count(), std::chrono::duration<double>(setup - begin).count());
+			return 0;
+		}
+
 
 		/*
 		 *	RC4 Evaluation / Tests
@@ -149,6 +201,7 @@ int main(int argc, char **argv) {
 		}
 
 		printf("[*] Encrypted %lu MB in %.2f seconds (%.2f MB/s)\n", (plaintext_size_bytes/(1024 * 1000)), float(time_ms/1000), float((plaintext_size_bytes / (1024 * 1000)) / float(time_ms/1000)));
+		rc4_energy_print(&energy, plaintext_size_bytes);
 
 	}
 	catch (cl::Error err) {
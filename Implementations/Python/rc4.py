@@ -22,6 +22,8 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 """
 
+import binascii
+import sys
 from timeit import default_timer as timer
 
 def KSA(key_hex, key_length):
@@ -38,7 +40,7 @@ def KSA(key_hex, key_length):
     
     # Run the algorithm
     for i in range(256):
-        j = (j + array_s[i] + ord(key_hex[i % key_length])) % 256
+        j = (j + array_s[i] + key_hex[i % key_length]) % 256
         tmp = array_s[i]
         array_s[i] = array_s[j]
         array_s[j] = tmp
@@ -70,65 +72,104 @@ def PRGA(array_s, payload_length):
 
 
 
+#### #### #### ####
+#   VECTOR MODE   #
+#### #### #### ####
+def run_vector(key_path, plaintext_path, ciphertext_path):
+    """
+        Encrypts the given files (used by ../rc4_crossbench.py)
+    """
+    with open(key_path, 'rb') as key_file:
+        key_hex = bytearray(key_file.read())
+    with open(plaintext_path, 'rb') as plaintext_file:
+        payload = bytearray(plaintext_file.read())
+
+    start = timer()
+    array_s = KSA(key_hex, len(key_hex))
+    setup = timer()
+    keystream = PRGA(array_s, len(payload))
+    cyphertext = bytearray(payload[i] ^ keystream[i] for i in range(len(payload)))
+    stop = timer()
+
+    with open(ciphertext_path, 'wb') as ciphertext_file:
+        ciphertext_file.write(cyphertext)
+    print('[*] Vector: {} byte in {:.6f} seconds (setup {:.6f} seconds)'.format(len(payload), stop - setup, setup - start))
+
+
+
 #### #### #### ####
 #  MAIN FUNCTION  #
 #### #### #### ####
-print '---- ---- ---- ---- ---- ---- ---- ----'
-print '      RC4 Python Implementation        '
-print '---- ---- ---- ---- ---- ---- ---- ----'
-print 'Author: Matthias Konrath'
-print 'Email:  matthas AT inet-sec.at'
-print '\n'
-
-key_str = "ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405"
-key_hex = key_str.decode("hex")
-key_length = len(key_str)/2
-
-payload_str = "3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595"
-payload_str_hex = payload_str.decode("hex")
-payload_str_length = len(payload_str)/2
-
-cyphertext = []
-
-print '[*] KEY:'
-print key_str
-print ''
-print '[*] Payload:'
-print payload_str
-print ''
-
-array_s = KSA(key_hex, key_length)
-print '[*] ARRAY_S:'
-print ''.join('{:02x}'.format(x) for x in array_s)
-print ''
-
-keystream = PRGA(array_s, payload_str_length)
-print '[*] KEYSTREAM:'
-print ''.join('{:02x}'.format(x) for x in keystream)
-print ''
-
-print '[*] CIPHERTEXT:'
-for i in range(payload_str_length):
-    cyphertext.append(ord(payload_str_hex[i]) ^ keystream[i])
-print ''.join('{:02x}'.format(x) for x in cyphertext)
-print ''
-
-
-print '[*] SPEED TEST'
-test_size_bytes = 1024 * 1000 * 50 # 50 Megabyte
-payload_str = "61" * test_size_bytes
-payload_str_hex = payload_str.decode("hex")
-payload_str_length = len(payload_str)/2
-cyphertext = []
-
-start = timer()
-array_s = KSA(key_hex, key_length)
-keystream = PRGA(array_s, payload_str_length)
-for i in range(payload_str_length):
-    cyphertext.append(ord(payload_str_hex[i]) ^ keystream[i])
-stop = timer()
-
-# For 50 MB --> 658b79745390f3ccd8242c9d0178a018add82ba8d0058adf9dfb3a2b02d188a3
-#last_bytes = ''.join('{:02x}'.format(x) for x in cyphertext[-32:])
-#print "[*] LAST 32 bytes: " + last_bytes
-print '[+] Encrypted {} MB in {:.2f} seconds ({:.2f} MB/s)'.format((test_size_bytes / (1024 * 1000)), (stop - start), float((float(test_size_bytes) / (1024 * 1000)) / float(stop - start)))
+def main():
+    print('---- ---- ---- ---- ---- ---- ---- ----')
+    print('      RC4 Python Implementation        ')
+    print('---- ---- ---- ---- ---- ---- ---- ----')
+    print('Author: Matthias Konrath')
+    print('Email:  matthas AT inet-sec.at')
+    print('\n')
+
+    key_str = "ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405"
+    key_hex = bytearray(binascii.unhexlify(key_str))
+    key_length = len(key_str) // 2
+
+    payload_str = "3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595"
+    payload_str_hex = bytearray(binascii.unhexlify(payload_str))
+    payload_str_length = len(payload_str) // 2
+
+    cyphertext = []
+
+    print('[*] KEY:')
+    print(key_str)
+    print('')
+    print('[*] Payload:')
+    print(payload_str)
+    print('')
+
+    array_s = KSA(key_hex, key_length)
+    print('[*] ARRAY_S:')
+    print(''.join('{:02x}'.format(x) for x in array_s))
+    print('')
+
+    keystream = PRGA(array_s, payload_str_length)
+    print('[*] KEYSTREAM:')
+    print(''.join('{:02x}'.format(x) for x in keystream))
+    print('')
+
+    print('[*] CIPHERTEXT:')
+    for i in range(payload_str_length):
+        cyphertext.append(payload_str_hex[i] ^ keystream[i])
+    print(''.join('{:02x}'.format(x) for x in cyphertext))
+    print('')
+
+
+    print('[*] SPEED TEST')
+    test_size_bytes = 1024 * 1000 * 50 # 50 Megabyte
+    payload_str = "61" * test_size_bytes
+    payload_str_hex = bytearray(binascii.unhexlify(payload_str))
+    payload_str_length = len(payload_str) // 2
+    cyphertext = []
+
+    start = timer()
+    array_s = KSA(key_hex, key_length)
+    keystream = PRGA(array_s, payload_str_length)
+    for i in range(payload_str_length):
+        cyphertext.append(payload_str_hex[i] ^ keystream[i])
+    stop = timer()
+
+    # For 50 MB --> 658b79745390f3ccd8242c9d0178a018add82ba8d0058adf9dfb3a2b02d188a3
+    #last_bytes = ''.join('{:02x}'.format(x) for x in cyphertext[-32:])
+    #print("[*] LAST 32 bytes: " + last_bytes)
+    print('[+] Encrypted {} MB in {:.2f} seconds ({:.2f} MB/s)'.format((test_size_bytes // (1024 * 1000)), (stop - start), float((float(test_size_bytes) / (1024 * 1000)) / float(stop - start))))
+
+
+# Python 2 and 3: python rc4.py
+# Vector mode:    python rc4.py -k key.bin -i plaintext.bin -o ciphertext.bin
+if __name__ == '__main__':
+    if len(sys.argv) == 7 and sys.argv[1::2] == ['-k', '-i', '-o']:
+        run_vector(sys.argv[2], sys.argv[4], sys.argv[6])
+    elif len(sys.argv) > 1:
+        print('[*] Application usage:')
+        print('  -k <file> -i <file> -o <file> : vector mode (binary key, plaintext and ciphertext files)')
+        sys.exit(1)
+    else:
+        main()
@@ -0,0 +1,423 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+CPython extension backed by the C++ engine (C++/rc4.h, C++/rc4_batch.h)
+
+Every data argument accepts any object implementing the buffer protocol
+(bytes, bytearray, memoryview, array.array, numpy arrays, mmap) and is used
+without copying, outputs are written into caller supplied buffers or a newly
+created bytes object. The GIL is released for buffers from
+RC4_NATIVE_GIL_THRESHOLD bytes on, so several Python threads can encrypt in
+parallel. A Context carries a lock (like hashlib objects) that is held while
+its state is advanced, so threads sharing one Context never run the kernel
+on it concurrently.
+
+	rc4_native.crypt(key, data[, out])      --> bytes (or None with out)
+	rc4_native.crypt_inplace(key, buffer)
+	rc4_native.keystream(key, size)         --> bytes
+	rc4_native.batch([(key, buffer), ...])  --> encrypts every buffer in place (multi-lane engine)
+	ctx = rc4_native.Context(key)           --> streaming state across calls
+	ctx.crypt(data[, out]), ctx.crypt_inplace(buffer)
+
+Compile with this command:
+	g++ -O2 -shared -fPIC $(python3-config --includes) -I../C++ -o rc4_native$(python3-config --extension-suffix) rc4_native.cpp ../C++/rc4_engine.cpp ../C++/rc4_batch.cpp ../C++/rc4_arena.cpp
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include "rc4.h"
+#include "rc4_batch.h"
+#include "rc4_arena.h"
+
+#define RC4_NATIVE_GIL_THRESHOLD (8 * 1024)
+
+
+// Key from any buffer, validated like rc4()
+static int get_key(PyObject* object, Py_buffer* key) {
+	if (PyObject_GetBuffer(object, key, PyBUF_SIMPLE) != 0)
+		return 1;
+	if (key->len == 0 || key->len > 32) {
+		PyErr_SetString(PyExc_ValueError, "The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)");
+		PyBuffer_Release(key);
+		return 1;
+	}
+	return 0;
+}
+
+static void crypt_kernel(rc4_ctx* ctx, uint8_t* source, uint8_t* target, uint64_t length) {
+	if (target == source)
+		encrypt_inplace(ctx, target, length);
+	else
+		rc4_crypt(ctx, source, target, length);
+}
+
+// Takes a Context lock with the GIL held, waiting without the GIL if another thread owns it
+static void acquire_context_lock(PyThread_type_lock lock) {
+	if (lock != NULL && !PyThread_acquire_lock(lock, 0)) {
+		Py_BEGIN_ALLOW_THREADS
+		PyThread_acquire_lock(lock, 1);
+		Py_END_ALLOW_THREADS
+	}
+}
+
+// Runs the kernel, without the GIL from RC4_NATIVE_GIL_THRESHOLD bytes on (lock is NULL for one-shot contexts)
+static void run_kernel(rc4_ctx* ctx, uint8_t* source, uint8_t* target, uint64_t length, PyThread_type_lock lock) {
+	if (length >= RC4_NATIVE_GIL_THRESHOLD) {
+		Py_BEGIN_ALLOW_THREADS
+		if (lock != NULL)
+			PyThread_acquire_lock(lock, 1);
+		crypt_kernel(ctx, source, target, length);
+		if (lock != NULL)
+			PyThread_release_lock(lock);
+		Py_END_ALLOW_THREADS
+	}
+	else {
+		acquire_context_lock(lock);
+		crypt_kernel(ctx, source, target, length);
+		if (lock != NULL)
+			PyThread_release_lock(lock);
+	}
+}
+
+// Out-of-place with an optional output buffer: same length, identical or not overlapping
+static PyObject* crypt_buffers(rc4_ctx* ctx, PyObject* data_object, PyObject* out_object, PyThread_type_lock lock) {
+	Py_buffer data;
+	Py_buffer out;
+	PyObject* result = NULL;
+
+	if (PyObject_GetBuffer(data_object, &data, PyBUF_SIMPLE) != 0)
+		return NULL;
+
+	uint8_t* target = NULL;
+	if (out_object == NULL || out_object == Py_None) {
+		result = PyBytes_FromStringAndSize(NULL, data.len);
+		if (result == NULL) {
+			PyBuffer_Release(&data);
+			return NULL;
+		}
+		target = (uint8_t*) PyBytes_AS_STRING(result);
+	}
+	else {
+		if (PyObject_GetBuffer(out_object, &out, PyBUF_WRITABLE) != 0) {
+			PyBuffer_Release(&data);
+			return NULL;
+		}
+		uint8_t* source = (uint8_t*) data.buf;
+		target = (uint8_t*) out.buf;
+		bool overlap = (target != source) && (target < source + data.len) && (source < target + out.len);
+		if (out.len != data.len || overlap) {
+			PyErr_SetString(PyExc_ValueError, "out has to have the length of data and must not partially overlap it");
+			PyBuffer_Release(&out);
+			PyBuffer_Release(&data);
+			return NULL;
+		}
+	}
+
+	run_kernel(ctx, (uint8_t*) data.buf, target, data.len, lock);
+
+	if (result == NULL) {
+		// Written into out
+		PyBuffer_Release(&out);
+		Py_INCREF(Py_None);
+		result = Py_None;
+	}
+	PyBuffer_Release(&data);
+	return result;
+}
+
+static PyObject* inplace_buffer(rc4_ctx* ctx, PyObject* object, PyThread_type_lock lock) {
+	Py_buffer buffer;
+	if (PyObject_GetBuffer(object, &buffer, PyBUF_WRITABLE) != 0)
+		return NULL;
+
+	run_kernel(ctx, (uint8_t*) buffer.buf, (uint8_t*) buffer.buf, buffer.len, lock);
+
+	PyBuffer_Release(&buffer);
+	Py_RETURN_NONE;
+}
+
+static int init_context(rc4_ctx* ctx, PyObject* key_object) {
+	Py_buffer key;
+	if (get_key(key_object, &key) != 0)
+		return 1;
+	rc4_init(ctx, (uint8_t*) key.buf, key.len);
+	PyBuffer_Release(&key);
+	return 0;
+}
+
+
+// ---- Context type ----
+
+struct ContextObject {
+	PyObject_HEAD
+	rc4_ctx ctx;
+	PyThread_type_lock lock;    // held while ctx is read or advanced
+	bool initialized;           // false until __init__ keyed ctx
+};
+
+static PyObject* Context_new(PyTypeObject* type, PyObject* /*args*/, PyObject* /*kwargs*/) {
+	ContextObject* self = (ContextObject*) type->tp_alloc(type, 0);
+	if (self == NULL)
+		return NULL;
+	self->initialized = false;
+	self->lock = PyThread_allocate_lock();
+	if (self->lock == NULL) {
+		Py_DECREF(self);
+		return PyErr_NoMemory();
+	}
+	return (PyObject*) self;
+}
+
+static void Context_dealloc(ContextObject* self) {
+	if (self->lock != NULL)
+		PyThread_free_lock(self->lock);
+	Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static int Context_init(ContextObject* self, PyObject* args, PyObject* kwargs) {
+	static const char* keywords[] = { "key", NULL };
+	PyObject* key = NULL;
+	rc4_ctx ctx;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char**) keywords, &key))
+		return -1;
+	if (init_context(&ctx, key) != 0)
+		return -1;
+	// Re-keying must not race a crypt() running without the GIL
+	acquire_context_lock(self->lock);
+	self->ctx = ctx;
+	self->initialized = true;
+	PyThread_release_lock(self->lock);
+	return 0;
+}
+
+// An S-box that was never keyed is all zero and would return the plaintext
+static int check_initialized(ContextObject* self) {
+	if (!self->initialized) {
+		PyErr_SetString(PyExc_RuntimeError, "Context was not initialized with a key (Context.__init__ was not called)");
+		return 1;
+	}
+	return 0;
+}
+
+static PyObject* Context_crypt(ContextObject* self, PyObject* args, PyObject* kwargs) {
+	static const char* keywords[] = { "data", "out", NULL };
+	PyObject* data = NULL;
+	PyObject* out = NULL;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", (char**) keywords, &data, &out))
+		return NULL;
+	if (check_initialized(self) != 0)
+		return NULL;
+	return crypt_buffers(&self->ctx, data, out, self->lock);
+}
+
+static PyObject* Context_crypt_inplace(ContextObject* self, PyObject* buffer) {
+	if (check_initialized(self) != 0)
+		return NULL;
+	return inplace_buffer(&self->ctx, buffer, self->lock);
+}
+
+static PyMethodDef Context_methods[] = {
+	{ "crypt", (PyCFunction) (void (*)(void)) Context_crypt, METH_VARARGS | METH_KEYWORDS,
+		"crypt(data[, out]) -> bytes or None\nContinues the keystream of this context." },
+	{ "crypt_inplace", (PyCFunction) Context_crypt_inplace, METH_O,
+		"crypt_inplace(buffer)\nEncrypts a writable buffer in place, continuing the keystream." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject ContextType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"rc4_native.Context",                       // tp_name
+	sizeof(ContextObject),                      // tp_basicsize
+};
+
+
+// ---- Module functions ----
+
+static PyObject* native_crypt(PyObject* module, PyObject* args, PyObject* kwargs) {
+	static const char* keywords[] = { "key", "data", "out", NULL };
+	PyObject* key = NULL;
+	PyObject* data = NULL;
+	PyObject* out = NULL;
+	rc4_ctx ctx;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|O", (char**) keywords, &key, &data, &out))
+		return NULL;
+	if (init_context(&ctx, key) != 0)
+		return NULL;
+	return crypt_buffers(&ctx, data, out, NULL);
+}
+
+static PyObject* native_crypt_inplace(PyObject* module, PyObject* args) {
+	PyObject* key = NULL;
+	PyObject* buffer = NULL;
+	rc4_ctx ctx;
+	if (!PyArg_ParseTuple(args, "OO", &key, &buffer))
+		return NULL;
+	if (init_context(&ctx, key) != 0)
+		return NULL;
+	return inplace_buffer(&ctx, buffer, NULL);
+}
+
+static PyObject* native_keystream(PyObject* module, PyObject* args) {
+	PyObject* key = NULL;
+	Py_ssize_t size = 0;
+	rc4_ctx ctx;
+	if (!PyArg_ParseTuple(args, "On", &key, &size))
+		return NULL;
+	if (size < 0) {
+		PyErr_SetString(PyExc_ValueError, "size has to be positive");
+		return NULL;
+	}
+	if (init_context(&ctx, key) != 0)
+		return NULL;
+
+	PyObject* result = PyBytes_FromStringAndSize(NULL, size);
+	if (result == NULL)
+		return NULL;
+	uint8_t* data = (uint8_t*) PyBytes_AS_STRING(result);
+	Py_BEGIN_ALLOW_THREADS
+	memset(data, 0, size);
+	encrypt_inplace(&ctx, data, size);
+	Py_END_ALLOW_THREADS
+	return result;
+}
+
+// batch([(key, buffer), ...]): every buffer is encrypted in place with its own key
+static PyObject* native_batch(PyObject* module, PyObject* jobs_object) {
+	PyObject* sequence = PySequence_Fast(jobs_object, "batch() expects a sequence of (key, buffer) tuples");
+	if (sequence == NULL)
+		return NULL;
+
+	// Per call arrays from the thread's pool (C++/rc4_arena.h), batches of small records are common
+	Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+	size_t keys_size = count * sizeof(Py_buffer);
+	size_t jobs_size = count * sizeof(rc4_job);
+	Py_buffer* keys = (Py_buffer*) rc4_pool_alloc(keys_size);
+	Py_buffer* buffers = (Py_buffer*) rc4_pool_alloc(keys_size);
+	rc4_job* jobs = (rc4_job*) rc4_pool_alloc(jobs_size);
+	if (count > 0 && (keys == NULL || buffers == NULL || jobs == NULL)) {
+		rc4_pool_free(jobs, jobs_size);
+		rc4_pool_free(buffers, keys_size);
+		rc4_pool_free(keys, keys_size);
+		Py_DECREF(sequence);
+		return PyErr_NoMemory();
+	}
+	Py_ssize_t acquired = 0;
+	uint64_t total = 0;
+	bool failed = false;
+
+	for (; acquired < count; acquired++) {
+		PyObject* item = PySequence_Fast_GET_ITEM(sequence, acquired);
+		PyObject* key = NULL;
+		PyObject* buffer = NULL;
+		if (!PyArg_ParseTuple(item, "OO", &key, &buffer)) {
+			failed = true;
+			break;
+		}
+		if (get_key(key, &keys[acquired]) != 0) {
+			failed = true;
+			break;
+		}
+		if (PyObject_GetBuffer(buffer, &buffers[acquired], PyBUF_WRITABLE) != 0) {
+			PyBuffer_Release(&keys[acquired]);
+			failed = true;
+			break;
+		}
+		rc4_job* job = &jobs[acquired];
+		job->key = (uint8_t*) keys[acquired].buf;
+		job->key_size = keys[acquired].len;
+		job->plaintext = (uint8_t*) buffers[acquired].buf;
+		job->ciphertext = (uint8_t*) buffers[acquired].buf;
+		job->size = buffers[acquired].len;
+		job->status = 0;
+		total += job->size;
+	}
+
+	if (!failed) {
+		if (total >= RC4_NATIVE_GIL_THRESHOLD) {
+			Py_BEGIN_ALLOW_THREADS
+			rc4_batch(jobs, count);
+			Py_END_ALLOW_THREADS
+		}
+		else {
+			rc4_batch(jobs, count);
+		}
+	}
+
+	for (Py_ssize_t n = 0; n < acquired; n++) {
+		PyBuffer_Release(&buffers[n]);
+		PyBuffer_Release(&keys[n]);
+	}
+	rc4_pool_free(jobs, jobs_size);
+	rc4_pool_free(buffers, keys_size);
+	rc4_pool_free(keys, keys_size);
+	Py_DECREF(sequence);
+	if (failed)
+		return NULL;
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef native_methods[] = {
+	{ "crypt", (PyCFunction) (void (*)(void)) native_crypt, METH_VARARGS | METH_KEYWORDS,
+		"crypt(key, data[, out]) -> bytes or None\nEncrypts / decrypts data, into out if given." },
+	{ "crypt_inplace", native_crypt_inplace, METH_VARARGS,
+		"crypt_inplace(key, buffer)\nEncrypts / decrypts a writable buffer in place." },
+	{ "keystream", native_keystream, METH_VARARGS,
+		"keystream(key, size) -> bytes\nThe first size keystream bytes." },
+	{ "batch", native_batch, METH_O,
+		"batch([(key, buffer), ...])\nEncrypts every buffer in place with its key (multi-lane engine)." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef native_module = {
+	PyModuleDef_HEAD_INIT,
+	"rc4_native",
+	"RC4 backed by the C++ engine, zero-copy on buffer protocol objects.",
+	-1,
+	native_methods
+};
+
+PyMODINIT_FUNC PyInit_rc4_native(void) {
+	ContextType.tp_flags = Py_TPFLAGS_DEFAULT;
+	ContextType.tp_doc = "Context(key)\nStreaming RC4 state, the keystream continues across calls.";
+	ContextType.tp_new = Context_new;
+	ContextType.tp_dealloc = (destructor) Context_dealloc;
+	ContextType.tp_init = (initproc) Context_init;
+	ContextType.tp_methods = Context_methods;
+	if (PyType_Ready(&ContextType) < 0)
+		return NULL;
+
+	PyObject* module = PyModule_Create(&native_module);
+	if (module == NULL)
+		return NULL;
+	Py_INCREF(&ContextType);
+	if (PyModule_AddObject(module, "Context", (PyObject*) &ContextType) < 0) {
+		Py_DECREF(&ContextType);
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
+}
@@ -0,0 +1,135 @@
+"""
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+"""
+
+# Self-test and speed test for the rc4_native extension (see rc4_native.cpp for the compile command)
+# Python 3: python3 rc4_native_speed_test.py
+# Vector mode (used by ../rc4_crossbench.py): python3 rc4_native_speed_test.py -k key.bin -i plaintext.bin -o ciphertext.bin
+
+import sys
+import threading
+from timeit import default_timer as timer
+
+import rc4_native
+
+
+if len(sys.argv) == 7 and sys.argv[1::2] == ['-k', '-i', '-o']:
+    with open(sys.argv[2], 'rb') as key_file:
+        vector_key = key_file.read()
+    with open(sys.argv[4], 'rb') as plaintext_file:
+        vector_payload = bytearray(plaintext_file.read())
+    start = timer()
+    vector_ctx = rc4_native.Context(vector_key)
+    setup = timer()
+    vector_ctx.crypt_inplace(vector_payload)
+    stop = timer()
+    with open(sys.argv[6], 'wb') as ciphertext_file:
+        ciphertext_file.write(vector_payload)
+    print('[*] Vector: {} byte in {:.6f} seconds (setup {:.6f} seconds)'.format(len(vector_payload), stop - setup, setup - start))
+    sys.exit(0)
+
+key = bytes.fromhex("ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405")
+plaintext = bytes.fromhex("3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595")
+known_ciphertext = bytes.fromhex("2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179")
+
+errors = 0
+
+# One shot, into a caller buffer and in place
+ciphertext = rc4_native.crypt(key, plaintext)
+errors += ciphertext != known_ciphertext
+
+out = bytearray(len(plaintext))
+rc4_native.crypt(key, memoryview(plaintext), out)
+errors += bytes(out) != known_ciphertext
+
+buffer = bytearray(plaintext)
+rc4_native.crypt_inplace(key, buffer)
+errors += bytes(buffer) != known_ciphertext
+
+# Streaming context: the keystream continues across calls
+ctx = rc4_native.Context(key)
+errors += ctx.crypt(plaintext[:13]) + ctx.crypt(plaintext[13:]) != known_ciphertext
+
+# A Context without __init__ has no key --> refuses to encrypt
+unkeyed = rc4_native.Context.__new__(rc4_native.Context)
+try:
+    unkeyed.crypt(plaintext)
+    errors += 1
+except RuntimeError:
+    pass
+
+# Threads sharing one Context: every call gets its own contiguous keystream segment
+chunk_size = 64 * 1024
+chunks = [bytearray(chunk_size) for _ in range(32)]
+shared = rc4_native.Context(key)
+sharing = [threading.Thread(target=lambda part: [shared.crypt_inplace(c) for c in part], args=(chunks[t::4],)) for t in range(4)]
+for worker in sharing:
+    worker.start()
+for worker in sharing:
+    worker.join()
+shared_keystream = rc4_native.keystream(key, chunk_size * len(chunks))
+segments = [shared_keystream[n:n + chunk_size] for n in range(0, len(shared_keystream), chunk_size)]
+errors += sorted(bytes(c) for c in chunks) != sorted(segments)
+
+# Keystream and batch
+keystream = rc4_native.keystream(key, len(plaintext))
+errors += bytes(a ^ b for a, b in zip(keystream, plaintext)) != known_ciphertext
+
+buffers = [bytearray(plaintext) for _ in range(6)]
+rc4_native.batch([(key, b) for b in buffers])
+errors += any(bytes(b) != known_ciphertext for b in buffers)
+
+print('[*] KEY:         0x' + key.hex())
+print('[*] Plaintext:   0x' + plaintext.hex())
+print('[*] Ciphertext:  0x' + ciphertext.hex())
+print('[*] Known Ciph.: 0x' + known_ciphertext.hex())
+print('---- ---- ---- ---- ---- ---- ---- ----')
+if errors == 0:
+    print('[*] ... PASSED ...')
+else:
+    print('[!] ... FAILED ...')
+print('---- ---- ---- ---- ---- ---- ---- ----')
+
+
+print('\n[*] SPEED TEST')
+test_size_bytes = 1024 * 1000 * 50 # 50 Megabyte
+payload = bytearray(b'a' * test_size_bytes)
+
+start = timer()
+rc4_native.crypt_inplace(key, payload)
+stop = timer()
+print('[+] Encrypted {} MB in {:.2f} seconds ({:.2f} MB/s)'.format(test_size_bytes // (1024 * 1000), stop - start,
+    (test_size_bytes / (1024 * 1000)) / (stop - start)))
+
+# The GIL is released during encryption --> threads run in parallel
+threads = 4
+payloads = [bytearray(b'a' * test_size_bytes) for _ in range(threads)]
+workers = [threading.Thread(target=rc4_native.crypt_inplace, args=(key, p)) for p in payloads]
+start = timer()
+for worker in workers:
+    worker.start()
+for worker in workers:
+    worker.join()
+stop = timer()
+print('[+] Encrypted {} x {} MB on {} threads in {:.2f} seconds ({:.2f} MB/s)'.format(threads, test_size_bytes // (1024 * 1000),
+    threads, stop - start, (threads * test_size_bytes / (1024 * 1000)) / (stop - start)))
@@ -67,6 +67,10 @@ module rc4(
     reg [7:0] prga_counter;
     reg [7:0] prga_j;
     reg [7:0] array_selector;
+    // i + 1 in 8 bit: wraps 255 --> 0 (a 32 bit "counter +1" never equals j = 0
+    // and indexes array_s[256])
+    wire [7:0] ksa_counter_next = ksa_counter + 8'd1;
+    wire [7:0] prga_counter_next = prga_counter + 8'd1;
     
     
     
@@ -145,7 +149,8 @@ module rc4(
                     key_cpy_counter <= key_cpy_counter +1;
                     if (key_cpy_counter == key_length -1) begin
                         fsm <= KSA;
-                        ksa_j <= (array_s[0] + key[0]);
+                        // key[0] is only written with this clock for a 1 byte key
+                        ksa_j <= (array_s[0] + ((key_length == 1) ? KEY_BYTE_IN : key[0]));
                     end
                 end // STOP KEY_CPY LOOP
             end // STOP KEY_CPY
@@ -154,15 +159,16 @@ module rc4(
             // ---- ---- ---- ---- ---- ---- ---- ----
            KSA: begin
                 ksa_counter <= ksa_counter +1;
-                if (ksa_counter +1 == ksa_j)
-                    ksa_j <= (ksa_j + array_s[(ksa_counter)] + key[(ksa_counter +1) % (key_length)]);
+                if (ksa_counter_next == ksa_j)
+                    ksa_j <= (ksa_j + array_s[(ksa_counter)] + key[ksa_counter_next % key_length]);
                 else
-                    ksa_j <= (ksa_j + array_s[(ksa_counter+1)] + key[(ksa_counter +1) % (key_length)]);
+                    ksa_j <= (ksa_j + array_s[ksa_counter_next] + key[ksa_counter_next % key_length]);
                 array_s[ksa_j] <= array_s[ksa_counter];
                 array_s[ksa_counter] <= array_s[ksa_j];
                 if (ksa_counter == 255) begin
                     fsm <= PRGA;
-                    prga_j <= prga_j + array_s[prga_counter];
+                    // The last KSA swap happens on this clock, forward S[1] if it moves
+                    prga_j <= prga_j + ((ksa_j == prga_counter) ? array_s[ksa_counter] : array_s[prga_counter]);
                     READ_PLAINTEXT_OUT <= 1'b1;
                 end
             end // STOP KSA
@@ -176,10 +182,10 @@ module rc4(
                 //begin
                     if (!HOLD_IN) begin
                         prga_counter <= prga_counter +1;
-                        if ((prga_counter +1) == prga_j)
+                        if (prga_counter_next == prga_j)
                             prga_j <= prga_j + array_s[prga_counter];
                         else
-                            prga_j <= prga_j + array_s[prga_counter +1];
+                            prga_j <= prga_j + array_s[prga_counter_next];
                         array_s[prga_j] <= array_s[prga_counter];
                         array_s[prga_counter] <= array_s[prga_j];
                         array_selector <= array_s[prga_j] + array_s[prga_counter];
@@ -0,0 +1,172 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include "Vrc4.h"
+#include "verilated.h"
+#include "rc4_rtl.h"
+
+// KEY_CPY + KSA take a fixed number of cycles, anything far beyond is a hang
+#define RC4_RTL_SETUP_LIMIT 4096
+
+// One rising edge, the inputs have to be set before
+static void tick(Vrc4* top) {
+	top->CLK_IN = 1;
+	top->eval();
+	top->CLK_IN = 0;
+	top->eval();
+}
+
+int rc4_rtl_open(rc4_rtl* rtl) {
+	rtl->top = new Vrc4;
+	rtl->reset_cycles = 0;
+	rtl->setup_cycles = 0;
+	rtl->crypt_cycles = 0;
+	rtl->hold_cycles = 0;
+	rtl->bytes = 0;
+	rtl->ready = false;
+
+	Vrc4* top = rtl->top;
+	top->CLK_IN = 0;
+	top->RESET_N_IN = 0;
+	top->KEY_SIZE_IN = 0;
+	top->KEY_BYTE_IN = 0;
+	top->PLAIN_BYTE_IN = 0;
+	top->START_IN = 0;
+	top->STOP_IN = 0;
+	top->HOLD_IN = 0;
+	top->eval();
+	return 0;
+}
+
+void rc4_rtl_close(rc4_rtl* rtl) {
+	if (rtl->top != NULL) {
+		rtl->top->final();
+		delete rtl->top;
+	}
+	rtl->top = NULL;
+	rtl->ready = false;
+}
+
+int rc4_rtl_init(rc4_rtl* rtl, uint8_t* key, uint16_t key_size) {
+	Vrc4* top = rtl->top;
+	rtl->ready = false;
+	rtl->reset_cycles = 0;
+	rtl->setup_cycles = 0;
+	rtl->crypt_cycles = 0;
+	rtl->hold_cycles = 0;
+	rtl->bytes = 0;
+
+	// Input Validation
+	if (key_size == 0 || key_size > 32) {
+		printf("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!\n");
+		return 1;
+	}
+
+	// RESET
+	top->RESET_N_IN = 0;
+	top->START_IN = 0;
+	top->HOLD_IN = 0;
+	top->PLAIN_BYTE_IN = 0;
+	top->KEY_BYTE_IN = 0;
+	for (int n = 0; n < 2; n++, rtl->reset_cycles++)
+		tick(top);
+	top->RESET_N_IN = 1;
+	top->KEY_SIZE_IN = key_size;
+
+	// START --> IDLE to KEY_CPY, the next clock latches KEY_SIZE_IN
+	top->START_IN = 1;
+	tick(top);
+	top->START_IN = 0;
+	rtl->setup_cycles++;
+	if (!top->START_KEY_CPY_OUT) {
+		printf("[!] START_KEY_CPY_OUT was not raised after START_IN!\n");
+		return 1;
+	}
+	tick(top);
+	rtl->setup_cycles++;
+
+	// KEY COPY: one KEY_BYTE_IN per clock
+	for (uint16_t n = 0; n < key_size; n++, rtl->setup_cycles++) {
+		top->KEY_BYTE_IN = key[n];
+		tick(top);
+	}
+	top->KEY_BYTE_IN = 0;
+
+	// KSA until READ_PLAINTEXT_OUT, then the first PRGA clock (computes the
+	// first S[i] + S[j], its ENC_BYTE_OUT is not part of the keystream)
+	while (!top->READ_PLAINTEXT_OUT) {
+		if (rtl->setup_cycles > RC4_RTL_SETUP_LIMIT) {
+			printf("[!] READ_PLAINTEXT_OUT was not raised after %llu cycles!\n", (unsigned long long) rtl->setup_cycles);
+			return 1;
+		}
+		tick(top);
+		rtl->setup_cycles++;
+	}
+	tick(top);
+	rtl->setup_cycles++;
+
+	rtl->ready = true;
+	return 0;
+}
+
+void rc4_rtl_crypt(rc4_rtl* rtl, const uint8_t* in, uint8_t* out, uint64_t len) {
+	Vrc4* top = rtl->top;
+	if (!rtl->ready)
+		return;
+
+	top->HOLD_IN = 0;
+	for (uint64_t n = 0; n < len; n++) {
+		top->PLAIN_BYTE_IN = in[n];
+		tick(top);
+		out[n] = top->ENC_BYTE_OUT;
+	}
+	rtl->crypt_cycles += len;
+	rtl->bytes += len;
+}
+
+void rc4_rtl_encrypt_inplace(rc4_rtl* rtl, uint8_t* buf, uint64_t len) {
+	rc4_rtl_crypt(rtl, buf, buf, len);
+}
+
+void rc4_rtl_hold(rc4_rtl* rtl, uint64_t cycles) {
+	Vrc4* top = rtl->top;
+	top->HOLD_IN = 1;
+	for (uint64_t n = 0; n < cycles; n++)
+		tick(top);
+	top->HOLD_IN = 0;
+	rtl->hold_cycles += cycles;
+}
+
+void rc4_rtl_print(rc4_rtl* rtl, double clock_mhz) {
+	uint64_t total = rtl->setup_cycles + rtl->crypt_cycles + rtl->hold_cycles;
+	printf("[*] RTL cycles: setup %llu, crypt %llu, hold %llu (reset %llu) for %llu byte\n",
+		(unsigned long long) rtl->setup_cycles, (unsigned long long) rtl->crypt_cycles,
+		(unsigned long long) rtl->hold_cycles, (unsigned long long) rtl->reset_cycles, (unsigned long long) rtl->bytes);
+	if (rtl->bytes > 0 && total > 0) {
+		printf("[*] %.3f cycles/byte (PRGA), %.3f cycles/byte including setup and holds --> %.2f MB/s at %.1f MHz\n",
+			double(rtl->crypt_cycles) / rtl->bytes, double(total) / rtl->bytes,
+			(double(rtl->bytes) / (1024 * 1000)) / (double(total) / (clock_mhz * 1e6)), clock_mhz);
+	}
+}
@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+rc4.v as a C++ engine (Verilator)
+
+The RTL is compiled into the Verilator model Vrc4 and driven through its
+real ports: START_IN, KEY_BYTE_IN while START_KEY_CPY_OUT / the key copy
+runs, then one PLAIN_BYTE_IN per clock with ENC_BYTE_OUT read back, HOLD_IN
+for stalls. The interface follows rc4_init() / rc4_crypt() /
+encrypt_inplace() of the C++ engine, so the same tests and benchmarks can run
+against the RTL, and every clock is counted.
+
+Cycle accounting (one rising edge = one cycle):
+  - reset_cycles: RESET_N_IN low, not part of the algorithm
+  - setup_cycles: START_IN until the first plaintext byte can be clocked in
+    (START, key length latch, key copy, 256 KSA cycles and the first PRGA
+    cycle that only computes the first S[i] + S[j]); 291 for a 32 byte key
+  - crypt_cycles: one per plaintext byte, ENC_BYTE_OUT is valid after the
+    clock that took the plaintext byte
+  - hold_cycles: clocks with HOLD_IN set (rc4_rtl_hold())
+Key sizes 1 - 32 byte are supported.
+
+Build (see rc4_rtl_test.cpp for the complete command):
+	verilator --cc --exe --build -O3 -Wno-fatal --top-module rc4 ... rc4.v rc4_rtl.cpp <main>.cpp
+*/
+
+#ifndef __RC4_RTL_H__
+#define __RC4_RTL_H__
+
+#include <stdint.h>
+
+class Vrc4;
+
+struct rc4_rtl {
+	Vrc4* top;
+	uint64_t reset_cycles;
+	uint64_t setup_cycles;
+	uint64_t crypt_cycles;
+	uint64_t hold_cycles;
+	uint64_t bytes;
+	bool ready;             // rc4_rtl_init() succeeded, the PRGA is running
+};
+
+int rc4_rtl_open(rc4_rtl* rtl);
+void rc4_rtl_close(rc4_rtl* rtl);
+
+// Reset + START + key copy + KSA, returns 0 on success (counters restart)
+int rc4_rtl_init(rc4_rtl* rtl, uint8_t* key, uint16_t key_size);
+// Keystream position survives between calls, in == out is allowed
+void rc4_rtl_crypt(rc4_rtl* rtl, const uint8_t* in, uint8_t* out, uint64_t len);
+void rc4_rtl_encrypt_inplace(rc4_rtl* rtl, uint8_t* buf, uint64_t len);
+// Clocks with HOLD_IN set, the keystream position must not move
+void rc4_rtl_hold(rc4_rtl* rtl, uint64_t cycles);
+void rc4_rtl_print(rc4_rtl* rtl, double clock_mhz);
+
+#endif
@@ -0,0 +1,251 @@
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+Self-test, cycle report and vector mode for the Verilator engine (rc4_rtl.h)
+
+Build (Verilator 4.x / 5.x, from Implementations/Verilog):
+	verilator --cc --exe --build -O3 -Wno-fatal --top-module rc4 --Mdir obj_rc4 \
+		-CFLAGS "-O2 -I$(pwd)/../C++" -o rc4_rtl_test \
+		rc4.v rc4_rtl.cpp rc4_rtl_test.cpp ../C++/rc4_engine.cpp
+	./obj_rc4/rc4_rtl_test -s 4096000
+
+The self-test checks the known vector, then streams -s byte per key through
+the RTL for several key sizes, in uneven pieces with HOLD_IN stalls between
+them, and compares everything with the C++ engine.
+*/
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include "rc4_rtl.h"
+#include "rc4.h"
+
+using namespace std;
+
+
+void print_help() {
+	printf("[*] Application usage:\n");
+	printf("  -s <bytes>   : plaintext size per key for the self-test (default 4 MB)\n");
+	printf("  -f <MHz>     : clock for the MB/s projection (default 115, Nexys 4 build)\n");
+	printf("  -k <file>    : vector mode, binary key (1 - 32 byte)\n");
+	printf("  -i <file>    : vector mode, binary plaintext\n");
+	printf("  -o <file>    : vector mode, binary ciphertext output\n");
+	printf("  -h           : print this message\n");
+}
+
+static int read_file(const char* path, vector<uint8_t>& data) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return 1;
+	uint8_t chunk[65536];
+	size_t received = 0;
+	data.clear();
+	while ((received = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		data.insert(data.end(), chunk, chunk + received);
+	fclose(file);
+	return 0;
+}
+
+// Same output format as the other vector modes (see ../rc4_crossbench.py), in cycles
+static int run_vector(const char* key_path, const char* plaintext_path, const char* ciphertext_path) {
+	vector<uint8_t> key;
+	vector<uint8_t> plaintext;
+	if (read_file(key_path, key) != 0 || read_file(plaintext_path, plaintext) != 0) {
+		printf("[!] Could not read the key / plaintext file!\n");
+		return 1;
+	}
+	vector<uint8_t> ciphertext(plaintext.size());
+
+	rc4_rtl rtl;
+	rc4_rtl_open(&rtl);
+	if (rc4_rtl_init(&rtl, key.data(), key.size()) != 0) {
+		rc4_rtl_close(&rtl);
+		return 1;
+	}
+	rc4_rtl_crypt(&rtl, plaintext.data(), ciphertext.data(), plaintext.size());
+
+	FILE* file = fopen(ciphertext_path, "wb");
+	if (file == NULL || fwrite(ciphertext.data(), 1, ciphertext.size(), file) != ciphertext.size()) {
+		printf("[!] Could not write the ciphertext file!\n");
+		if (file != NULL)
+			fclose(file);
+		rc4_rtl_close(&rtl);
+		return 1;
+	}
+	fclose(file);
+	printf("[*] Vector: %zu byte in %llu cycles (setup %llu cycles)\n", plaintext.size(),
+		(unsigned long long) rtl.crypt_cycles, (unsigned long long) rtl.setup_cycles);
+	rc4_rtl_close(&rtl);
+	return 0;
+}
+
+// Returns the number of mismatching keys
+static int stream_test(rc4_rtl* rtl, uint64_t size, double clock_mhz) {
+	const uint16_t key_sizes[] = { 1, 2, 5, 16, 31, 32 };
+	int error = 0;
+	vector<uint8_t> plaintext(size);
+	vector<uint8_t> expected(size);
+	vector<uint8_t> ciphertext(size);
+	uint8_t key[32];
+
+	srand(1);
+	for (uint16_t key_size : key_sizes) {
+		for (uint32_t n = 0; n < 32; n++)
+			key[n] = rand();
+		for (uint64_t n = 0; n < size; n++)
+			plaintext[n] = rand();
+
+		rc4_ctx ctx;
+		rc4_init(&ctx, key, key_size);
+		rc4_crypt(&ctx, plaintext.data(), expected.data(), size);
+
+		if (rc4_rtl_init(rtl, key, key_size) != 0)
+			return error + 1;
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		uint64_t offset = 0;
+		for (uint64_t piece = 1; offset < size; piece = piece * 3 + 1) {
+			uint64_t length = (size - offset < piece) ? size - offset : piece;
+			rc4_rtl_crypt(rtl, plaintext.data() + offset, ciphertext.data() + offset, length);
+			rc4_rtl_hold(rtl, piece % 7);
+			offset += length;
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(end - begin).count();
+
+		uint64_t mismatch = size;
+		for (uint64_t n = 0; n < size && mismatch == size; n++) {
+			if (ciphertext[n] != expected[n])
+				mismatch = n;
+		}
+		printf("[*] Key size %2u: ", key_size);
+		if (mismatch == size)
+			printf("%llu byte match the C++ engine", (unsigned long long) size);
+		else
+			printf("first mismatch at byte %llu", (unsigned long long) mismatch);
+		printf(" (%.2f M cycles/s simulated)\n", (rtl->setup_cycles + rtl->crypt_cycles + rtl->hold_cycles) / seconds / 1e6);
+		rc4_rtl_print(rtl, clock_mhz);
+		error += (mismatch == size) ? 0 : 1;
+	}
+	return error;
+}
+
+int main(int argc, char** argv)
+{
+	// Variable Definition
+	int i = 0;
+	int error = 0;
+	uint64_t size = 1024 * 1000 * 4; // 4 Megabyte
+	double clock_mhz = 115.0;
+	const char* key_path = NULL;
+	const char* plaintext_path = NULL;
+	const char* ciphertext_path = NULL;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-s") == 0) && (i < (argc - 1))) { size = strtoull(argv[++i], NULL, 10); }
+		else if ((strcmp(argv[i], "-f") == 0) && (i < (argc - 1))) { clock_mhz = atof(argv[++i]); }
+		else if ((strcmp(argv[i], "-k") == 0) && (i < (argc - 1))) { key_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-i") == 0) && (i < (argc - 1))) { plaintext_path = argv[++i]; }
+		else if ((strcmp(argv[i], "-o") == 0) && (i < (argc - 1))) { ciphertext_path = argv[++i]; }
+		else if (strcmp(argv[i], "-h") == 0) { print_help(); return 0; }
+		else { print_help(); return 1; }
+	}
+
+	if (key_path != NULL || plaintext_path != NULL || ciphertext_path != NULL) {
+		if (key_path == NULL || plaintext_path == NULL || ciphertext_path == NULL) {
+			printf("[!] Vector mode needs -k, -i and -o!\n");
+			return 1;
+		}
+		return run_vector(key_path, plaintext_path, ciphertext_path);
+	}
+
+	const uint16_t key_size = 32;
+	// ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405
+	uint8_t key[key_size] = {
+			0xae, 0x6c, 0x3c, 0x41, 0x88, 0x4d, 0x35, 0xdf,
+			0x3a, 0xb5, 0xad, 0xf3, 0x0f, 0x5b, 0x2d, 0x36,
+			0x09, 0x38, 0xc6, 0x58, 0x34, 0x18, 0x86, 0xb0,
+			0xba, 0x51, 0x0b, 0x42, 0x1e, 0x5a, 0xb4, 0x05
+	};
+
+	const uint32_t plaintext_size = 32;
+	// 3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595
+	uint8_t plaintext[plaintext_size] = {
+			0x3a, 0xe2, 0x80, 0xd0, 0xd5, 0xcd, 0x70, 0xd8,
+			0xe0, 0xf8, 0x13, 0x00, 0xdc, 0x90, 0x31, 0xa2,
+			0xe0, 0xf8, 0x51, 0x2c, 0xb3, 0x5a, 0x75, 0x79,
+			0xfd, 0x79, 0x57, 0x5c, 0xf2, 0x87, 0xc5, 0x95
+	};
+
+	// 2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179
+	uint8_t known_ciphertext[plaintext_size] = {
+			0x22, 0x80, 0xc9, 0x67, 0x6c, 0x8f, 0x5c, 0x52,
+			0xab, 0xa8, 0xd4, 0x26, 0x11, 0xf8, 0x5e, 0x7c,
+			0xa9, 0x61, 0xa2, 0x11, 0x7d, 0x3c, 0xfc, 0x82,
+			0x36, 0xa6, 0x05, 0x1b, 0xbf, 0xc5, 0xf1, 0x79
+	};
+
+	uint8_t ciphertext[plaintext_size] = {0};
+
+	rc4_rtl rtl;
+	rc4_rtl_open(&rtl);
+	if (rc4_rtl_init(&rtl, key, key_size) != 0) {
+		rc4_rtl_close(&rtl);
+		return 1;
+	}
+	rc4_rtl_crypt(&rtl, plaintext, ciphertext, plaintext_size);
+
+	printf("[*] Ciphertext:  0x");
+	for (i = 0; i < (int) plaintext_size; i++) {
+		printf("%02x", static_cast<int>(ciphertext[i]));
+		if (ciphertext[i] != known_ciphertext[i])
+			error += 1;
+	}
+	printf("\n");
+	printf("[*] Known Ciph.: 0x");
+	for (i = 0; i < (int) plaintext_size; i++)
+		printf("%02x", static_cast<int>(known_ciphertext[i]));
+	printf("\n");
+	rc4_rtl_print(&rtl, clock_mhz);
+
+	// Multi-MB streams against the C++ engine
+	if (size > 0)
+		error += stream_test(&rtl, size, clock_mhz);
+	rc4_rtl_close(&rtl);
+
+	// Print PASS / FAIL
+	printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+	if (error == 0) {
+		printf("[*] ... PASSED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+		return 0;
+	}
+	else {
+		printf("[!] ... FAILED ...\n");
+		printf("---- ---- ---- ---- ---- ---- ---- ----\n");
+		return 1;
+	}
+}
@@ -0,0 +1,242 @@
+`timescale 1ns / 1ps
+/*
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+    File driven testbench (used by ../rc4_crossbench.py)
+
+    Streams a binary key (1 - 32 byte) and a plaintext of any size through
+    rc4.v, one byte per clock, and writes the ciphertext as one hex byte per
+    line. Reports the setup cycles (START_IN until READ_PLAINTEXT_OUT, i.e.
+    key copy + KSA) and the cycles from the first plaintext byte until the
+    last ciphertext byte was captured.
+
+    Icarus Verilog:
+        iverilog -g2005 -o rc4_vector_tb rc4.v rc4_vector_tb.v
+        vvp -n rc4_vector_tb +KEY=key.bin +PLAINTEXT=plaintext.bin +CIPHERTEXT=ciphertext.hex
+*/
+
+module rc4_vector_tb;
+
+reg CLK;
+reg RESET_N;
+reg [7:0] KEY [0:31];
+reg [7:0] KEY_SIZE;
+reg [8*1024-1:0] key_path;
+reg [8*1024-1:0] plaintext_path;
+reg [8*1024-1:0] ciphertext_path;
+
+integer key_file, plaintext_file, ciphertext_file;
+integer key_counter, byte_in, x;
+integer cycle, start_cycle, setup_cycles, fed, captured;
+reg feeding, fed_all, valid_fed, valid_enc;
+
+
+
+// ---- ---- ---- ---- ---- ---- ---- ----
+//              RC4 INTERFACE
+// ---- ---- ---- ---- ---- ---- ---- ----
+reg [7:0] KEY_BYTE;
+reg [7:0] PLAIN_BYTE;
+reg START;
+reg STOP;
+reg HOLD;
+wire START_KEY_CPY;
+wire BUSY;
+wire READ_PLAINTEXT;
+wire [7:0] ENC_BYTE;
+
+rc4 rc4_interface(
+    .CLK_IN(CLK),
+    .RESET_N_IN(RESET_N),
+    .KEY_SIZE_IN(KEY_SIZE),
+    .KEY_BYTE_IN(KEY_BYTE),
+    .PLAIN_BYTE_IN(PLAIN_BYTE),
+    .START_IN(START),
+    .STOP_IN(STOP),
+    .HOLD_IN(HOLD),
+    .START_KEY_CPY_OUT(START_KEY_CPY),
+    .BUSY_OUT(BUSY),
+    .READ_PLAINTEXT_OUT(READ_PLAINTEXT),
+    .ENC_BYTE_OUT(ENC_BYTE)
+);
+// STOP RC4 INTERFACE
+
+
+
+// ---- ---- ---- ---- ---- ---- ---- ----
+//                  CLOCK
+// ---- ---- ---- ---- ---- ---- ---- ----
+always begin
+    CLK = 1'b1;
+    #1;
+    CLK = 1'b0;
+    #1;
+end // STOP CLOCK
+
+
+
+// ---- ---- ---- ---- ---- ---- ---- ----
+//              CYCLE COUNTER
+// ---- ---- ---- ---- ---- ---- ---- ----
+always @(posedge CLK) begin
+    cycle <= cycle +1;
+    if (START)
+        start_cycle <= cycle;
+    // KEY_CPY + KSA take a fixed number of cycles, anything far beyond is a hang
+    if (!feeding && !fed_all && start_cycle >= 0 && cycle - start_cycle > 4096) begin
+        $display("[!] READ_PLAINTEXT_OUT was not raised after %0d cycles!", cycle - start_cycle);
+        $display("[!] ... FAILED ...");
+        $finish;
+    end
+end // STOP CYCLE COUNTER
+
+
+
+// ---- ---- ---- ---- ---- ---- ---- ----
+//              KEY TRNASFARE
+// ---- ---- ---- ---- ---- ---- ---- ----
+always @(posedge CLK) begin
+    if (START_KEY_CPY || key_counter) begin
+        if (key_counter == KEY_SIZE) begin
+            key_counter <= 0;
+            KEY_BYTE <= 8'b00;
+        end else begin
+            key_counter <= key_counter +1;
+            KEY_BYTE <= KEY[key_counter];
+        end
+    end
+end // STOP KEY TRANSFARE
+
+
+
+// ---- ---- ---- ---- ---- ---- ---- ----
+//    PLAINTEXT / CIPHERTEXT TRNASFARE
+// ---- ---- ---- ---- ---- ---- ---- ----
+// A plaintext byte driven at clock n is consumed at n+1, its ciphertext is
+// on ENC_BYTE_OUT after n+1 and captured at n+2 (valid_fed --> valid_enc).
+always @(posedge CLK) begin
+    valid_fed <= 0;
+    if ((READ_PLAINTEXT || feeding) && !fed_all) begin
+        if (READ_PLAINTEXT)
+            setup_cycles <= cycle - start_cycle;
+        byte_in = $fgetc(plaintext_file);
+        if (byte_in == -1) begin
+            feeding <= 0;
+            fed_all <= 1;
+            PLAIN_BYTE <= 8'b00;
+        end else begin
+            feeding <= 1;
+            fed <= fed +1;
+            valid_fed <= 1;
+            PLAIN_BYTE <= byte_in[7:0];
+        end
+    end
+
+    valid_enc <= valid_fed;
+    if (valid_enc) begin
+        $fwrite(ciphertext_file, "%h\n", ENC_BYTE);
+        captured <= captured +1;
+    end
+
+    if (fed_all && captured == fed) begin
+        $fclose(ciphertext_file);
+        $display("[*] Vector: %0d byte in %0d cycles (setup %0d cycles)", fed, cycle - start_cycle - setup_cycles, setup_cycles);
+        $display("[*] ... DONE ...");
+        $finish;
+    end
+end // STOP PLAINTEXT / CIPHERTEXT TRANSFARE
+
+
+
+// ---- ---- ---- ---- ---- ---- ---- ----
+//                  MAIN
+// ---- ---- ---- ---- ---- ---- ---- ----
+initial begin
+    // ---- ---- ---- ---- ---- ---- ---- ----
+    //              SETUP
+    // ---- ---- ---- ---- ---- ---- ---- ----
+    RESET_N = 0;
+    START = 0;
+    HOLD = 0;
+    STOP = 0;
+    KEY_BYTE = 0;
+    PLAIN_BYTE = 0;
+    KEY_SIZE = 0;
+    key_counter = 0;
+    cycle = 0;
+    start_cycle = -1;
+    setup_cycles = 0;
+    fed = 0;
+    captured = 0;
+    feeding = 0;
+    fed_all = 0;
+    valid_fed = 0;
+    valid_enc = 0;
+
+    if (!$value$plusargs("KEY=%s", key_path) || !$value$plusargs("PLAINTEXT=%s", plaintext_path) || !$value$plusargs("CIPHERTEXT=%s", ciphertext_path)) begin
+        $display("[*] Application usage: vvp -n rc4_vector_tb +KEY=<file> +PLAINTEXT=<file> +CIPHERTEXT=<file>");
+        $finish;
+    end
+    key_file = $fopen(key_path, "rb");
+    plaintext_file = $fopen(plaintext_path, "rb");
+    ciphertext_file = $fopen(ciphertext_path, "w");
+    if (key_file == 0 || plaintext_file == 0 || ciphertext_file == 0) begin
+        $display("[!] Could not open the key / plaintext / ciphertext file!");
+        $finish;
+    end
+
+    // Key: up to 32 byte
+    for (x = 0; x < 32; x = x+1)
+        KEY[x] = 8'h00;
+    byte_in = $fgetc(key_file);
+    while (byte_in != -1 && KEY_SIZE < 32) begin
+        KEY[KEY_SIZE] = byte_in[7:0];
+        KEY_SIZE = KEY_SIZE +1;
+        byte_in = $fgetc(key_file);
+    end
+    $fclose(key_file);
+    if (KEY_SIZE == 0 || byte_in != -1) begin
+        $display("[!] The key size is either zero or longer than 32 byte --> 256 bit (which is not allowed)!");
+        $finish;
+    end
+    $display("[*] ENCRYPTION KEY: (SIZE: 0x%H)", KEY_SIZE);
+
+    #5;
+    RESET_N = 1;
+    // STOP SETUP
+
+
+
+    // ---- ---- ---- ---- ---- ---- ---- ----
+    //              START SIGNAL
+    // ---- ---- ---- ---- ---- ---- ---- ----
+    // Driven between clock edges, so exactly one rising edge samples it
+    @(negedge CLK);
+    START = 1;
+    @(negedge CLK);
+    START = 0;
+    // STOP START SIGNAL
+end // STOP MAIN
+endmodule // STOP RC4_VECTOR_TB
@@ -0,0 +1,352 @@
+"""
+MIT License
+
+Copyright (c) 2021 Matthias Konrath
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+"""
+
+# Cross-implementation benchmark: runs every implementation in this repository
+# on the same key / plaintext, checks each output against the C++ engine and
+# writes one comparable results table.
+#
+#   python3 rc4_crossbench.py                      # all runtimes, 1 MB
+#   python3 rc4_crossbench.py -s 10240000 -e cpp,opencl,rtl-iverilog -o results.md
+#
+# Runtimes whose toolchain is missing are listed as skipped:
+#   cpp            C++/rc4.cpp (reference, g++)
+#   python         Python/rc4.py (pure Python)
+#   python-native  Python/rc4_native.cpp (CPython extension on the C++ engine)
+#   opencl         OpenCL/rc4_opencl_speed_test.cpp, any OpenCL runtime (pocl gives a CPU device)
+#   hls-csim       HLS/rc4.cpp C simulation, needs ap_int.h / hls_stream.h ($XILINX_HLS/include)
+#   rtl-iverilog   Verilog/rc4.v in Icarus Verilog (iverilog / vvp)
+#   rtl-verilator  Verilog/rc4.v compiled by Verilator (Verilog/rc4_rtl.h)
+#
+# Every runtime times its own work and excludes process start / compilation.
+# "Setup" is the one-time cost before the first byte (KSA, OpenCL context and
+# kernel build), "Encrypt" the processing of the plaintext. RTL rows count
+# clock cycles and project MB/s at --rtl-mhz. 1 MB = 1024 * 1000 byte, as in
+# the speed tests of the single implementations.
+
+import argparse
+import os
+import platform
+import random
+import re
+import shutil
+import subprocess
+import sys
+import sysconfig
+import tempfile
+from timeit import default_timer as timer
+
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+MB = 1024 * 1000
+RUNTIMES = ['cpp', 'python', 'python-native', 'opencl', 'hls-csim', 'rtl-iverilog', 'rtl-verilator']
+
+KNOWN_KEY = bytes.fromhex('ae6c3c41884d35df3ab5adf30f5b2d360938c658341886b0ba510b421e5ab405')
+KNOWN_PLAINTEXT = bytes.fromhex('3ae280d0d5cd70d8e0f81300dc9031a2e0f8512cb35a7579fd79575cf287c595')
+KNOWN_CIPHERTEXT = bytes.fromhex('2280c9676c8f5c52aba8d42611f85e7ca961a2117d3cfc8236a6051bbfc5f179')
+
+VECTOR_SECONDS = re.compile(r'\[\*\] Vector: (\d+) byte in ([0-9.]+) seconds(?: \(setup ([0-9.]+) seconds\))?')
+VECTOR_CYCLES = re.compile(r'\[\*\] Vector: (\d+) byte in (\d+) cycles \(setup (\d+) cycles\)')
+
+
+class Skipped(Exception):
+    pass
+
+
+def run(command, cwd=None, env=None, timeout=None):
+    """
+        Runs a command, returns its stdout, raises RuntimeError with the output on failure
+    """
+    result = subprocess.run(command, cwd=cwd, env=env, timeout=timeout, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        raise RuntimeError('{} failed ({}):\n{}'.format(command[0], result.returncode, result.stdout[-2000:]))
+    return result.stdout
+
+
+def build(command, cwd=None):
+    """
+        Compile step: a missing compiler / header / library skips the runtime
+    """
+    if shutil.which(command[0]) is None:
+        raise Skipped('{} not found'.format(command[0]))
+    try:
+        run(command, cwd=cwd)
+    except RuntimeError as error:
+        lines = [line for line in str(error).splitlines() if 'error' in line.lower() or 'fatal' in line.lower()]
+        raise Skipped('build failed: ' + (lines[0].strip() if lines else command[0]))
+
+
+def parse_vector(output):
+    """
+        Returns (size, encrypt, setup, unit), setup is None if the runtime cannot separate it
+    """
+    match = VECTOR_CYCLES.search(output)
+    if match:
+        return int(match.group(1)), int(match.group(2)), int(match.group(3)), 'cycles'
+    match = VECTOR_SECONDS.search(output)
+    if match:
+        setup = float(match.group(3)) if match.group(3) is not None else None
+        return int(match.group(1)), float(match.group(2)), setup, 'seconds'
+    raise RuntimeError('no vector result in the output:\n' + output[-2000:])
+
+
+#### #### #### ####
+#     RUNTIMES    #
+#### #### #### ####
+def vector_args(vector):
+    return ['-k', vector['key'], '-i', vector['plaintext'], '-o', vector['ciphertext']]
+
+
+def runtime_cpp(work, vector, options):
+    binary = os.path.join(work, 'rc4')
+    source = os.path.join(ROOT, 'C++')
+    # Built once for the known vector, the reference and the table row
+    if not os.path.exists(binary):
+        build([options.cxx, '-O1', '-o', binary, 'rc4.cpp', 'rc4_engine.cpp', 'rc4_perf.cpp', 'rc4_arena.cpp'], cwd=source)
+    return run([binary] + vector_args(vector), timeout=options.timeout), ''
+
+
+def runtime_python(work, vector, options):
+    return run([sys.executable, os.path.join(ROOT, 'Python', 'rc4.py')] + vector_args(vector), timeout=options.timeout), ''
+
+
+def runtime_python_native(work, vector, options):
+    source = os.path.join(ROOT, 'Python')
+    engine = os.path.join(ROOT, 'C++')
+    module = os.path.join(work, 'rc4_native' + sysconfig.get_config_var('EXT_SUFFIX'))
+    build([options.cxx, '-O2', '-shared', '-fPIC', '-I' + sysconfig.get_paths()['include'], '-I' + engine, '-o', module,
+        'rc4_native.cpp', os.path.join(engine, 'rc4_engine.cpp'), os.path.join(engine, 'rc4_batch.cpp'),
+        os.path.join(engine, 'rc4_arena.cpp')], cwd=source)
+    env = dict(os.environ, PYTHONPATH=work)
+    return run([sys.executable, os.path.join(source, 'rc4_native_speed_test.py')] + vector_args(vector), env=env, timeout=options.timeout), ''
+
+
+def runtime_opencl(work, vector, options):
+    binary = os.path.join(work, 'rc4_opencl_speed_test')
+    source = os.path.join(ROOT, 'OpenCL')
+    build([options.cxx, '-O2', '-I' + source, '-o', binary, 'rc4_opencl_speed_test.cpp', '-lOpenCL'], cwd=source)
+    # The kernel source is loaded relative to the working directory
+    command = [binary, '-p', str(options.opencl_platform), '-d', str(options.opencl_device)] + vector_args(vector)
+    output = run(command, cwd=source, timeout=options.timeout)
+    device = re.search(r'Runinng on (.*)', output)
+    return output, device.group(1).strip() if device else ''
+
+
+def runtime_hls_csim(work, vector, options):
+    include = options.hls_include
+    for variable in ['XILINX_HLS', 'XILINX_VIVADO']:
+        if include is None and os.environ.get(variable):
+            include = os.path.join(os.environ[variable], 'include')
+    if include is None or not os.path.exists(os.path.join(include, 'hls_stream.h')):
+        raise Skipped('hls_stream.h not found (set XILINX_HLS or --hls-include)')
+    binary = os.path.join(work, 'rc4_vector_tb')
+    build([options.cxx, '-O2', '-I' + include, '-o', binary, 'rc4.cpp', 'rc4_vector_tb.cpp'], cwd=os.path.join(ROOT, 'HLS'))
+    return run([binary, vector['key'], vector['plaintext'], vector['ciphertext']], timeout=options.timeout), 'C simulation'
+
+
+def runtime_rtl_iverilog(work, vector, options):
+    binary = os.path.join(work, 'rc4_vector_tb.vvp')
+    source = os.path.join(ROOT, 'Verilog')
+    build(['iverilog', '-g2005', '-o', binary, 'rc4.v', 'rc4_vector_tb.v'], cwd=source)
+    if shutil.which('vvp') is None:
+        raise Skipped('vvp not found')
+    hex_path = vector['ciphertext'] + '.hex'
+    start = timer()
+    output = run(['vvp', '-n', binary, '+KEY=' + vector['key'], '+PLAINTEXT=' + vector['plaintext'], '+CIPHERTEXT=' + hex_path], timeout=options.timeout)
+    wall = timer() - start
+    with open(hex_path) as hex_file, open(vector['ciphertext'], 'wb') as ciphertext_file:
+        ciphertext_file.write(bytes(int(line, 16) for line in hex_file if line.strip()))
+    return output, 'Icarus, simulated in {:.1f} s'.format(wall)
+
+
+def runtime_rtl_verilator(work, vector, options):
+    source = os.path.join(ROOT, 'Verilog')
+    model = os.path.join(work, 'obj_rc4')
+    build(['verilator', '--cc', '--exe', '--build', '-O3', '-Wno-fatal', '--top-module', 'rc4', '--Mdir', model,
+        '-CFLAGS', '-O2 -I' + os.path.join(ROOT, 'C++'), '-o', 'rc4_rtl_test',
+        os.path.join(source, 'rc4.v'), os.path.join(source, 'rc4_rtl.cpp'), os.path.join(source, 'rc4_rtl_test.cpp'),
+        os.path.join(ROOT, 'C++', 'rc4_engine.cpp')])
+    start = timer()
+    output = run([os.path.join(model, 'rc4_rtl_test')] + vector_args(vector), timeout=options.timeout)
+    return output, 'Verilator, simulated in {:.1f} s'.format(timer() - start)
+
+
+RUNNERS = {
+    'cpp': ('C++', runtime_cpp),
+    'python': ('Python', runtime_python),
+    'python-native': ('Python (rc4_native)', runtime_python_native),
+    'opencl': ('OpenCL', runtime_opencl),
+    'hls-csim': ('HLS (C-sim)', runtime_hls_csim),
+    'rtl-iverilog': ('Verilog (RTL sim)', runtime_rtl_iverilog),
+    'rtl-verilator': ('Verilog (Verilator)', runtime_rtl_verilator),
+}
+
+
+#### #### #### ####
+#     HARNESS     #
+#### #### #### ####
+def write_vector(work, name, key, plaintext):
+    vector = {
+        'key': os.path.join(work, name + '_key.bin'),
+        'plaintext': os.path.join(work, name + '_plaintext.bin'),
+        'ciphertext': os.path.join(work, name + '_ciphertext.bin'),
+    }
+    with open(vector['key'], 'wb') as key_file:
+        key_file.write(key)
+    with open(vector['plaintext'], 'wb') as plaintext_file:
+        plaintext_file.write(plaintext)
+    return vector
+
+
+def read_output(path):
+    with open(path, 'rb') as output_file:
+        return output_file.read()
+
+
+def first_mismatch(a, b):
+    for n in range(min(len(a), len(b))):
+        if a[n] != b[n]:
+            return n
+    return min(len(a), len(b))
+
+
+def host_name():
+    try:
+        with open('/proc/cpuinfo') as cpuinfo:
+            for line in cpuinfo:
+                if line.startswith('model name'):
+                    return line.split(':', 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or platform.machine()
+
+
+def format_row(name, size, result, setup, encrypt, speed, notes):
+    return '| {} | {} | {} | {} | {} | {} | {} |'.format(name, size, result, setup, encrypt, speed, notes)
+
+
+def bench(runtime, work, vector, reference, options):
+    """
+        Returns one table row, never raises for a single runtime
+    """
+    name, runner = RUNNERS[runtime]
+    size = len(reference)
+    try:
+        output, notes = runner(work, vector, options)
+        measured_size, encrypt, setup, unit = parse_vector(output)
+        ciphertext = read_output(vector['ciphertext'])
+    except Skipped as reason:
+        return format_row(name, '-', 'skipped', '-', '-', '-', str(reason))
+    except (RuntimeError, OSError, subprocess.TimeoutExpired) as error:
+        return format_row(name, '-', 'error', '-', '-', '-', str(error).splitlines()[0])
+
+    if ciphertext == reference and measured_size == size:
+        result = 'match'
+    else:
+        result = 'MISMATCH @ byte {}'.format(first_mismatch(ciphertext, reference))
+
+    if unit == 'cycles':
+        seconds = encrypt / (options.rtl_mhz * 1e6)
+        notes = '{:.3f} cycles/byte @ {} MHz, {}'.format(encrypt / max(size, 1), options.rtl_mhz, notes)
+        return format_row(name, size, result, '{} cycles'.format(setup), '{} cycles'.format(encrypt),
+            '{:.2f}'.format(size / MB / seconds) if seconds > 0 else '-', notes)
+    return format_row(name, size, result, '{:.6f} s'.format(setup) if setup is not None else 'incl.', '{:.6f} s'.format(encrypt),
+        '{:.2f}'.format(size / MB / encrypt) if encrypt > 0 else '-', notes)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='RC4 cross-implementation benchmark')
+    parser.add_argument('-s', '--size', type=int, default=MB, help='plaintext size in byte (default 1 MB)')
+    parser.add_argument('-k', '--key-size', type=int, default=32, help='key size in byte, 1 - 32 (default 32)')
+    parser.add_argument('--seed', type=int, default=0, help='seed of the key / plaintext generator')
+    parser.add_argument('-e', '--runtimes', default=','.join(RUNTIMES), help='comma separated subset of ' + ','.join(RUNTIMES))
+    parser.add_argument('-o', '--output', help='also write the markdown table to this file')
+    parser.add_argument('-w', '--work', help='build / vector directory (default: temporary)')
+    parser.add_argument('--cxx', default='g++')
+    parser.add_argument('--opencl-platform', type=int, default=0)
+    parser.add_argument('--opencl-device', type=int, default=0)
+    parser.add_argument('--hls-include', help='directory with ap_int.h / hls_stream.h')
+    parser.add_argument('--rtl-mhz', type=float, default=115.0, help='clock for the RTL projection (default 115, Nexys 4 build)')
+    parser.add_argument('--timeout', type=int, default=3600, help='per runtime timeout in seconds')
+    options = parser.parse_args()
+
+    runtimes = [runtime.strip() for runtime in options.runtimes.split(',') if runtime.strip()]
+    unknown = [runtime for runtime in runtimes if runtime not in RUNNERS]
+    if unknown or not 1 <= options.key_size <= 32 or options.size < 1:
+        parser.error('unknown runtime {} or invalid size'.format(','.join(unknown)))
+
+    work = options.work or tempfile.mkdtemp(prefix='rc4_crossbench_')
+    os.makedirs(work, exist_ok=True)
+
+    # The C++ engine is the reference, but only after it reproduced the known vector
+    known = write_vector(work, 'known', KNOWN_KEY, KNOWN_PLAINTEXT)
+    try:
+        runtime_cpp(work, known, options)
+    except (Skipped, RuntimeError) as error:
+        print('[!] The C++ reference could not be built / run: {}'.format(error))
+        return 1
+    if read_output(known['ciphertext']) != KNOWN_CIPHERTEXT:
+        print('[!] The C++ reference does not reproduce the known ciphertext!')
+        return 1
+
+    generator = random.Random(options.seed)
+    key = bytes(generator.getrandbits(8) for _ in range(options.key_size))
+    plaintext = generator.randbytes(options.size) if hasattr(generator, 'randbytes') else bytes(generator.getrandbits(8) for _ in range(options.size))
+    vector = write_vector(work, 'vector', key, plaintext)
+    runtime_cpp(work, vector, options)
+    reference = read_output(vector['ciphertext'])
+
+    print('[*] Host:      {}'.format(host_name()))
+    print('[*] Vector:    {} byte plaintext, {} byte key (seed {})'.format(options.size, options.key_size, options.seed))
+    print('[*] Directory: {}'.format(work))
+    table = [
+        '| Implementation | Size (byte) | Result | Setup | Encrypt | Speed (MB/s) | Notes |',
+        '| ------ | ------ | ------ | ------ | ------ | ------ | ------ |',
+    ]
+    errors = 0
+    for runtime in runtimes:
+        # Fresh output file per runtime, a failed run must not see the previous ciphertext
+        if os.path.exists(vector['ciphertext']):
+            os.remove(vector['ciphertext'])
+        print('[*] Running {} ...'.format(runtime))
+        row = bench(runtime, work, vector, reference, options)
+        errors += ('MISMATCH' in row) or ('| error |' in row)
+        table.append(row)
+
+    print('')
+    print('\n'.join(table))
+    if options.output:
+        with open(options.output, 'w') as output_file:
+            output_file.write('Host: {}, {} byte plaintext, {} byte key (seed {})\n\n'.format(host_name(), options.size, options.key_size, options.seed))
+            output_file.write('\n'.join(table) + '\n')
+    if not options.work:
+        shutil.rmtree(work, ignore_errors=True)
+
+    print('---- ---- ---- ---- ---- ---- ---- ----')
+    print('[*] ... PASSED ...' if errors == 0 else '[!] ... FAILED ...')
+    print('---- ---- ---- ---- ---- ---- ---- ----')
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())